@@ -0,0 +1,376 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#include "contraction_hierarchy.h"
+#include <boost/foreach.hpp>
+#include <queue>
+#include <unordered_map>
+
+namespace bt = boost::posix_time;
+
+namespace navitia { namespace georef {
+
+constexpr ContractionHierarchy::local_vertex_t ContractionHierarchy::invalid_vertex;
+
+namespace {
+
+typedef ContractionHierarchy::local_vertex_t local_vertex_t;
+
+/// arc of the graph being contracted
+struct BuildArc {
+    local_vertex_t other;
+    bt::time_duration duration;
+    local_vertex_t middle;
+};
+
+/// add the arc, if there is already one to the same vertex we keep the shortest
+void add_arc(std::vector<BuildArc>& arcs, local_vertex_t other, bt::time_duration duration, local_vertex_t middle) {
+    for (auto& arc: arcs) {
+        if (arc.other == other) {
+            if (duration < arc.duration) {
+                arc.duration = duration;
+                arc.middle = middle;
+            }
+            return;
+        }
+    }
+    arcs.push_back({other, duration, middle});
+}
+
+struct Contractor {
+    std::vector<std::vector<BuildArc>> out;
+    std::vector<std::vector<BuildArc>> in;
+    std::vector<bool> contracted;
+    std::vector<int> contracted_neighbours;
+    size_t max_settled;
+
+    /// distances of the witness search, only the touched vertices are reset between 2 searches
+    std::vector<bt::time_duration> witness_distances;
+    std::vector<local_vertex_t> touched;
+
+    Contractor(size_t nb_vertices, size_t max_settled) : out(nb_vertices), in(nb_vertices),
+        contracted(nb_vertices, false), contracted_neighbours(nb_vertices, 0), max_settled(max_settled),
+        witness_distances(nb_vertices, bt::pos_infin) {}
+
+    /// bounded dijkstra from source on the non contracted vertices, without going through avoided
+    void witness_search(local_vertex_t source, local_vertex_t avoided, bt::time_duration max_duration) {
+        for (auto v: touched) {
+            witness_distances[v] = bt::pos_infin;
+        }
+        touched.clear();
+
+        typedef std::pair<bt::time_duration, local_vertex_t> queue_elt;
+        std::priority_queue<queue_elt, std::vector<queue_elt>, std::greater<queue_elt>> queue;
+        witness_distances[source] = bt::seconds(0);
+        touched.push_back(source);
+        queue.push({bt::seconds(0), source});
+
+        size_t nb_settled = 0;
+        while (! queue.empty() && nb_settled < max_settled) {
+            const auto elt = queue.top();
+            queue.pop();
+            if (elt.first > witness_distances[elt.second]) {
+                continue;
+            }
+            if (elt.first > max_duration) {
+                break;
+            }
+            ++nb_settled;
+            for (const auto& arc: out[elt.second]) {
+                if (arc.other == avoided || contracted[arc.other]) {
+                    continue;
+                }
+                const auto duration = elt.first + arc.duration;
+                if (duration < witness_distances[arc.other]) {
+                    if (witness_distances[arc.other] == bt::pos_infin) {
+                        touched.push_back(arc.other);
+                    }
+                    witness_distances[arc.other] = duration;
+                    queue.push({duration, arc.other});
+                }
+            }
+        }
+    }
+
+    /// count the shortcuts needed to contract v, and add them if apply is set
+    size_t contract(local_vertex_t v, bool apply) {
+        size_t nb_shortcuts = 0;
+        for (const auto& in_arc: in[v]) {
+            const auto u = in_arc.other;
+            if (contracted[u]) {
+                continue;
+            }
+            boost::optional<bt::time_duration> max_out;
+            for (const auto& out_arc: out[v]) {
+                if (contracted[out_arc.other] || out_arc.other == u) {
+                    continue;
+                }
+                if (! max_out || *max_out < out_arc.duration) {
+                    max_out = out_arc.duration;
+                }
+            }
+            if (! max_out) {
+                continue;
+            }
+            witness_search(u, v, in_arc.duration + *max_out);
+
+            for (const auto& out_arc: out[v]) {
+                const auto x = out_arc.other;
+                if (contracted[x] || x == u) {
+                    continue;
+                }
+                const auto through_v = in_arc.duration + out_arc.duration;
+                if (witness_distances[x] <= through_v) {
+                    continue; //there is a path as short without v
+                }
+                ++nb_shortcuts;
+                if (apply) {
+                    add_arc(out[u], x, through_v, v);
+                    add_arc(in[x], u, through_v, v);
+                }
+            }
+        }
+        return nb_shortcuts;
+    }
+
+    /// the vertices with the lowest priority are contracted first
+    int priority(local_vertex_t v) {
+        int degree = 0;
+        for (const auto& arc: in[v]) {
+            if (! contracted[arc.other]) { ++degree; }
+        }
+        for (const auto& arc: out[v]) {
+            if (! contracted[arc.other]) { ++degree; }
+        }
+        const int edge_difference = int(contract(v, false)) - degree;
+        return 2 * edge_difference + contracted_neighbours[v];
+    }
+};
+
+/// flatten the arcs by vertex in a CSR like structure
+void flatten(const std::vector<std::vector<ContractionHierarchy::Arc>>& arcs_by_vertex,
+             std::vector<size_t>& index, std::vector<ContractionHierarchy::Arc>& arcs) {
+    index.clear();
+    arcs.clear();
+    index.reserve(arcs_by_vertex.size() + 1);
+    for (const auto& vertex_arcs: arcs_by_vertex) {
+        index.push_back(arcs.size());
+        arcs.insert(arcs.end(), vertex_arcs.begin(), vertex_arcs.end());
+    }
+    index.push_back(arcs.size());
+}
+
+}
+
+ContractionHierarchy::ContractionHierarchy(const GeoRef& geo_ref, nt::Mode_e mode, size_t max_witness_settled) :
+    offset(geo_ref.offsets[mode]), nb_vertices(geo_ref.nb_vertex_by_mode) {
+    Contractor contractor(nb_vertices, max_witness_settled);
+
+    //we only keep the edges of the subgraph of the mode
+    for (local_vertex_t u = 0; u < nb_vertices; ++u) {
+        BOOST_FOREACH(edge_t e, boost::out_edges(offset + u, geo_ref.graph)) {
+            const vertex_t target = boost::target(e, geo_ref.graph);
+            if (target < offset || target >= offset + nb_vertices || target == offset + u) {
+                continue;
+            }
+            const local_vertex_t v = target - offset;
+            const auto duration = geo_ref.graph[e].duration;
+            add_arc(contractor.out[u], v, duration, invalid_vertex);
+            add_arc(contractor.in[v], u, duration, invalid_vertex);
+        }
+    }
+
+    typedef std::pair<int, local_vertex_t> queue_elt;
+    std::priority_queue<queue_elt, std::vector<queue_elt>, std::greater<queue_elt>> queue;
+    for (local_vertex_t v = 0; v < nb_vertices; ++v) {
+        queue.push({contractor.priority(v), v});
+    }
+
+    rank.assign(nb_vertices, 0);
+    local_vertex_t current_rank = 0;
+    while (! queue.empty()) {
+        const auto v = queue.top().second;
+        queue.pop();
+        //lazy update, the priority might have changed since the vertex has been pushed
+        const int priority = contractor.priority(v);
+        if (! queue.empty() && priority > queue.top().first) {
+            queue.push({priority, v});
+            continue;
+        }
+        nb_shortcuts += contractor.contract(v, true);
+        contractor.contracted[v] = true;
+        rank[v] = current_rank++;
+        for (const auto& arc: contractor.in[v]) {
+            if (! contractor.contracted[arc.other]) { ++contractor.contracted_neighbours[arc.other]; }
+        }
+        for (const auto& arc: contractor.out[v]) {
+            if (! contractor.contracted[arc.other]) { ++contractor.contracted_neighbours[arc.other]; }
+        }
+    }
+
+    std::vector<std::vector<Arc>> up(nb_vertices), down(nb_vertices);
+    for (local_vertex_t u = 0; u < nb_vertices; ++u) {
+        for (const auto& arc: contractor.out[u]) {
+            if (rank[u] < rank[arc.other]) {
+                up[u].push_back({arc.other, arc.duration, arc.middle});
+            } else {
+                down[arc.other].push_back({u, arc.duration, arc.middle});
+            }
+        }
+    }
+    flatten(up, up_index, up_arcs);
+    flatten(down, down_index, down_arcs);
+}
+
+const ContractionHierarchy::Arc* ContractionHierarchy::find_arc(local_vertex_t from, local_vertex_t to) const {
+    if (rank[from] < rank[to]) {
+        for (size_t i = up_index[from]; i < up_index[from + 1]; ++i) {
+            if (up_arcs[i].other == to) { return &up_arcs[i]; }
+        }
+    } else {
+        for (size_t i = down_index[to]; i < down_index[to + 1]; ++i) {
+            if (down_arcs[i].other == from) { return &down_arcs[i]; }
+        }
+    }
+    return nullptr;
+}
+
+void ContractionHierarchy::unpack(local_vertex_t from, local_vertex_t to, std::vector<vertex_t>& path) const {
+    const Arc* arc = find_arc(from, to);
+    if (! arc || arc->middle == invalid_vertex) {
+        path.push_back(offset + to);
+        return;
+    }
+    unpack(from, arc->middle, path);
+    unpack(arc->middle, to, path);
+}
+
+std::pair<bt::time_duration, std::vector<vertex_t>> ContractionHierarchy::shortest_path(
+        const std::vector<std::pair<vertex_t, bt::time_duration>>& sources,
+        const std::vector<std::pair<vertex_t, bt::time_duration>>& targets,
+        float speed_factor) const {
+    typedef std::pair<bt::time_duration, local_vertex_t> queue_elt;
+    typedef std::priority_queue<queue_elt, std::vector<queue_elt>, std::greater<queue_elt>> queue_t;
+    struct Label {
+        bt::time_duration duration;
+        local_vertex_t parent;
+    };
+    typedef std::unordered_map<local_vertex_t, Label> labels_t;
+
+    //the search is done with the durations at the default speed
+    auto init = [&](const std::vector<std::pair<vertex_t, bt::time_duration>>& seeds, labels_t& labels, queue_t& queue) {
+        for (const auto& seed: seeds) {
+            if (seed.first < offset || seed.first >= offset + nb_vertices || seed.second == bt::pos_infin) {
+                continue;
+            }
+            const local_vertex_t v = seed.first - offset;
+            const auto duration = bt::milliseconds(int64_t(seed.second.total_milliseconds() * speed_factor));
+            auto it = labels.find(v);
+            if (it == labels.end() || duration < it->second.duration) {
+                labels[v] = {duration, v};
+                queue.push({duration, v});
+            }
+        }
+    };
+
+    labels_t forward, backward;
+    queue_t forward_queue, backward_queue;
+    init(sources, forward, forward_queue);
+    init(targets, backward, backward_queue);
+
+    bt::time_duration best = bt::pos_infin;
+    local_vertex_t meeting = invalid_vertex;
+
+    auto settle = [&](queue_t& queue, labels_t& labels, const labels_t& other_labels,
+                      const std::vector<size_t>& index, const std::vector<Arc>& arcs) {
+        const auto elt = queue.top();
+        queue.pop();
+        const auto v = elt.second;
+        if (elt.first > labels[v].duration) {
+            return;
+        }
+        auto other = other_labels.find(v);
+        if (other != other_labels.end() && elt.first + other->second.duration < best) {
+            best = elt.first + other->second.duration;
+            meeting = v;
+        }
+        for (size_t i = index[v]; i < index[v + 1]; ++i) {
+            const Arc& arc = arcs[i];
+            const auto duration = elt.first + arc.duration;
+            auto it = labels.find(arc.other);
+            if (it == labels.end() || duration < it->second.duration) {
+                labels[arc.other] = {duration, v};
+                queue.push({duration, arc.other});
+            }
+        }
+    };
+
+    auto can_improve = [&](const queue_t& queue) { return ! queue.empty() && queue.top().first < best; };
+    while (can_improve(forward_queue) || can_improve(backward_queue)) {
+        if (can_improve(forward_queue)) {
+            settle(forward_queue, forward, backward, up_index, up_arcs);
+        }
+        if (can_improve(backward_queue)) {
+            settle(backward_queue, backward, forward, down_index, down_arcs);
+        }
+    }
+
+    if (meeting == invalid_vertex) {
+        return {bt::pos_infin, {}};
+    }
+
+    //from the source to the meeting vertex with the forward search
+    std::vector<local_vertex_t> forward_vertices;
+    local_vertex_t current = meeting;
+    while (forward.at(current).parent != current) {
+        forward_vertices.push_back(current);
+        current = forward.at(current).parent;
+    }
+    forward_vertices.push_back(current);
+    std::reverse(forward_vertices.begin(), forward_vertices.end());
+
+    std::vector<vertex_t> path;
+    path.push_back(offset + forward_vertices.front());
+    for (size_t i = 1; i < forward_vertices.size(); ++i) {
+        unpack(forward_vertices[i - 1], forward_vertices[i], path);
+    }
+
+    //and then to the target with the backward search
+    current = meeting;
+    while (backward.at(current).parent != current) {
+        const auto next = backward.at(current).parent;
+        unpack(current, next, path);
+        current = next;
+    }
+
+    return {bt::milliseconds(int64_t(best.total_milliseconds() / speed_factor)), path};
+}
+
+}}//namespace navitia::georef
@@ -0,0 +1,101 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+#include "georef.h"
+#include <limits>
+
+namespace navitia { namespace georef {
+
+/** Contraction hierarchy of the subgraph of one transportation mode
+  *
+  * The vertices are contracted one by one, the less important first, and shortcuts are added
+  * between their neighbours to keep the shortest durations between the remaining vertices.
+  * A query is then a bidirectional dijkstra only going toward more important vertices,
+  * it settles a few hundred vertices where a plain dijkstra explores the whole region.
+  *
+  * The durations are the ones of the graph at the default speed of the mode,
+  * a speed factor being applied to all the edges it does not change the shortest path.
+  */
+struct ContractionHierarchy {
+    typedef uint32_t local_vertex_t;
+    static constexpr local_vertex_t invalid_vertex = std::numeric_limits<local_vertex_t>::max();
+
+    struct Arc {
+        local_vertex_t other; //< target of an upward arc, source of a downward arc
+        boost::posix_time::time_duration duration;
+        local_vertex_t middle; //< contracted vertex for a shortcut, invalid_vertex for an edge of the graph
+    };
+
+    /// first vertex of the subgraph in the GeoRef graph
+    vertex_t offset = 0;
+    size_t nb_vertices = 0;
+
+    /// contraction order of each vertex
+    std::vector<local_vertex_t> rank;
+
+    /// arcs toward a more important vertex, by source
+    std::vector<size_t> up_index;
+    std::vector<Arc> up_arcs;
+
+    /// arcs coming from a more important vertex, by target
+    std::vector<size_t> down_index;
+    std::vector<Arc> down_arcs;
+
+    /// number of shortcuts added by the contraction
+    size_t nb_shortcuts = 0;
+
+    /**
+     * Contract the subgraph of the transportation mode
+     * max_witness_settled bounds the local searches done to avoid useless shortcuts
+     */
+    ContractionHierarchy(const GeoRef& geo_ref, nt::Mode_e mode, size_t max_witness_settled = 50);
+
+    /**
+     * Compute the shortest path between some sources and some targets of the GeoRef graph
+     * each given with the duration to reach them (or leave them) at the given speed factor
+     *
+     * return the duration at the given speed factor and the vertices of the path
+     * (the duration is pos_infin and the path empty if the targets cannot be reached)
+     */
+    std::pair<boost::posix_time::time_duration, std::vector<vertex_t>> shortest_path(
+            const std::vector<std::pair<vertex_t, boost::posix_time::time_duration>>& sources,
+            const std::vector<std::pair<vertex_t, boost::posix_time::time_duration>>& targets,
+            float speed_factor = 1) const;
+
+private:
+    /// the arc between 2 vertices, either upward or downward
+    const Arc* find_arc(local_vertex_t from, local_vertex_t to) const;
+
+    /// add to the path the graph vertices of the arc from -> to, from excluded
+    void unpack(local_vertex_t from, local_vertex_t to, std::vector<vertex_t>& path) const;
+};
+
+}}//namespace navitia::georef
@@ -0,0 +1,160 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#include "edge_index.h"
+#include "proximity_list/proximity_list.h"
+#include <boost/foreach.hpp>
+
+namespace navitia { namespace georef {
+
+constexpr double EdgeIndex::cell_size;
+
+namespace {
+
+int cell(double degree) {
+    return static_cast<int>(std::floor(degree / EdgeIndex::cell_size));
+}
+
+uint64_t cell_key(int x, int y) {
+    return (uint64_t(uint32_t(x)) << 32) | uint32_t(y);
+}
+
+/// cells crossed by the segment [a, b]
+std::vector<uint64_t> crossed_cells(const type::GeographicalCoord& a, const type::GeographicalCoord& b) {
+    std::vector<uint64_t> result;
+    //we cut the segment in pieces shorter than a cell, each piece can only cross the cells of its bounding box
+    const double dlon = b.lon() - a.lon(), dlat = b.lat() - a.lat();
+    const size_t nb_pieces = 1 + size_t(std::max(std::abs(dlon), std::abs(dlat)) / EdgeIndex::cell_size);
+    for(size_t i = 0; i < nb_pieces; ++i){
+        const double lon1 = a.lon() + dlon * i / nb_pieces, lon2 = a.lon() + dlon * (i + 1) / nb_pieces;
+        const double lat1 = a.lat() + dlat * i / nb_pieces, lat2 = a.lat() + dlat * (i + 1) / nb_pieces;
+        for(int x = cell(std::min(lon1, lon2)); x <= cell(std::max(lon1, lon2)); ++x){
+            for(int y = cell(std::min(lat1, lat2)); y <= cell(std::max(lat1, lat2)); ++y){
+                result.push_back(cell_key(x, y));
+            }
+        }
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+}
+
+EdgeIndex::EdgeIndex(const GeoRef& geo_ref, vertex_t begin, vertex_t end) : geo_ref(geo_ref) {
+    std::vector<std::pair<uint64_t, uint32_t>> edges_by_cell;
+    for(vertex_t u = begin; u < end && u < boost::num_vertices(geo_ref.graph); ++u){
+        BOOST_FOREACH(edge_t e, boost::out_edges(u, geo_ref.graph)){
+            const auto& source = geo_ref.graph[u].coord;
+            const auto& target = geo_ref.graph[boost::target(e, geo_ref.graph)].coord;
+            for(uint64_t key : crossed_cells(source, target)){
+                edges_by_cell.push_back(std::make_pair(key, uint32_t(edges.size())));
+            }
+            edges.push_back(e);
+        }
+    }
+    std::sort(edges_by_cell.begin(), edges_by_cell.end());
+
+    min_x = min_y = std::numeric_limits<int>::max();
+    max_x = max_y = std::numeric_limits<int>::min();
+    cell_edges.reserve(edges_by_cell.size());
+    for(uint32_t i = 0; i < edges_by_cell.size();){
+        const uint64_t key = edges_by_cell[i].first;
+        const uint32_t first = i;
+        for(; i < edges_by_cell.size() && edges_by_cell[i].first == key; ++i){
+            cell_edges.push_back(edges_by_cell[i].second);
+        }
+        cells[key] = std::make_pair(first, i);
+        const int x = int32_t(key >> 32), y = int32_t(key & 0xffffffff);
+        min_x = std::min(min_x, x);
+        max_x = std::max(max_x, x);
+        min_y = std::min(min_y, y);
+        max_y = std::max(max_y, y);
+    }
+}
+
+edge_t EdgeIndex::nearest_edge(const type::GeographicalCoord& coord, double max_dist) const {
+    if(cells.empty())
+        throw proximitylist::NotFound();
+
+    const double coslat = ::cos(coord.lat() * 0.0174532925199432958);
+    //smallest width of a cell, a ring of cells is at least this far from the previous ring
+    const double cell_width = cell_size * 111320 * std::min(1., coslat);
+    //an edge and its reverse edge are on the same segment, the projection can differ by a rounding error
+    const double epsilon = 0.01;
+
+    bool found = false;
+    edge_t best;
+    double best_dist = max_dist, best_source_dist = 0;
+    auto check_cell = [&](int x, int y){
+        auto it = cells.find(cell_key(x, y));
+        if(it == cells.end())
+            return;
+        for(uint32_t i = it->second.first; i < it->second.second; ++i){
+            const edge_t& e = edges[cell_edges[i]];
+            const auto& source = geo_ref.graph[boost::source(e, geo_ref.graph)].coord;
+            const double dist = coord.project(source, geo_ref.graph[boost::target(e, geo_ref.graph)].coord).second;
+            if(dist > best_dist + epsilon)
+                continue;
+            //on equality, we keep the edge starting from the nearest vertex
+            const double source_dist = coord.distance_to(source);
+            if(!found || dist < best_dist - epsilon || source_dist < best_source_dist){
+                found = true;
+                best = e;
+                best_dist = std::min(dist, best_dist);
+                best_source_dist = source_dist;
+            }
+        }
+    };
+
+    const int center_x = cell(coord.lon()), center_y = cell(coord.lat());
+    //beyond this ring, there is no more edge
+    const int last_ring = std::max(std::max(std::abs(center_x - min_x), std::abs(max_x - center_x)),
+                                   std::max(std::abs(center_y - min_y), std::abs(max_y - center_y)));
+    for(int ring = 0; ring <= last_ring; ++ring){
+        for(int x = center_x - ring; x <= center_x + ring; ++x){
+            if(std::abs(x - center_x) == ring){
+                for(int y = center_y - ring; y <= center_y + ring; ++y)
+                    check_cell(x, y);
+            } else {
+                check_cell(x, center_y - ring);
+                check_cell(x, center_y + ring);
+            }
+        }
+        const double covered_dist = ring * cell_width;
+        if((found && best_dist + epsilon < covered_dist) || covered_dist > max_dist)
+            break;
+    }
+    if(!found)
+        throw proximitylist::NotFound();
+    return best;
+}
+
+}}
@@ -0,0 +1,66 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+#include "georef.h"
+#include <unordered_map>
+
+namespace navitia { namespace georef {
+
+/** Spatial index of the edges of the subgraph of one transportation mode
+  *
+  * The edges are put in a grid of cells of cell_size degrees, each edge being in all the cells
+  * its segment crosses. Projecting a coordinate is then a single search in the cells around it,
+  * and a long edge is found even if both its ends are far from the coordinate.
+  */
+struct EdgeIndex {
+    /// size of the cells of the grid (in degrees)
+    static constexpr double cell_size = 0.002;
+
+    /// index the out edges of the vertices in [begin, end[
+    EdgeIndex(const GeoRef& geo_ref, vertex_t begin, vertex_t end);
+
+    /// nearest edge within max_dist meters, throws proximitylist::NotFound if there is none
+    edge_t nearest_edge(const type::GeographicalCoord& coord, double max_dist = 500) const;
+
+    size_t nb_edges() const { return edges.size(); }
+
+private:
+    const GeoRef& geo_ref;
+    std::vector<edge_t> edges;
+    /// index of the edges (in edges) ordered by cell
+    std::vector<uint32_t> cell_edges;
+    /// range in cell_edges of each non empty cell
+    std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> cells;
+    /// bounds of the non empty cells
+    int min_x = 0, max_x = 0, min_y = 0, max_y = 0;
+};
+
+}}
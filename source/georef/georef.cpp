@@ -29,6 +29,9 @@ www.navitia.io
 */
 
 #include "georef.h"
+#include "contraction_hierarchy.h"
+#include "edge_index.h"
+#include "type/parallel.h"
 
 #include "utils/logger.h"
 #include "utils/functions.h"
@@ -39,6 +42,7 @@ www.navitia.io
 #include <boost/foreach.hpp>
 #include <array>
 #include <boost/math/constants/constants.hpp>
+#include <numeric>
 
 using navitia::type::idx_t;
 
@@ -423,6 +427,21 @@ void GeoRef::build_rtree() {
     }
 }
 
+void GeoRef::build_contraction_hierarchies(const std::vector<nt::Mode_e>& modes) {
+    auto log = log4cplus::Logger::getInstance("kraken::georef::build_contraction_hierarchies");
+    for (nt::Mode_e mode : modes) {
+        //bss use 2 graphs, it cannot be contracted as one subgraph
+        if (mode == nt::Mode_e::Bss) {
+            LOG4CPLUS_WARN(log, "no contraction hierarchy can be built for bss");
+            continue;
+        }
+        auto ch = std::make_shared<ContractionHierarchy>(*this, mode);
+        LOG4CPLUS_INFO(log, "contraction hierarchy built for mode " << int(mode)
+                       << " with " << ch->nb_shortcuts << " shortcuts");
+        contraction_hierarchies[mode] = ch;
+    }
+}
+
 /** Normalisation des codes externes des rues*/
 void GeoRef::normalize_extcode_way(){
     this->way_map.clear();
@@ -495,11 +514,18 @@ void GeoRef::project_stop_points(const std::vector<type::StopPoint*> &stop_point
    };
    navitia::flat_enum_map<error, int> messages {{{}}};
 
+   //the projections are independent, each one is done in its own slot
+   std::vector<std::pair<GeoRef::ProjectionByMode, bool>> projections(stop_points.size());
+   parallel_for(stop_points.size(), [&](size_t i) {
+       projections[i] = project_stop_point(stop_points[i]);
+   });
+
    this->projected_stop_points.clear();
    this->projected_stop_points.reserve(stop_points.size());
 
-   for(const type::StopPoint* stop_point : stop_points) {
-       std::pair<GeoRef::ProjectionByMode, bool> pair = project_stop_point(stop_point);
+   for(size_t i = 0; i < stop_points.size(); ++i) {
+       const type::StopPoint* stop_point = stop_points[i];
+       const std::pair<GeoRef::ProjectionByMode, bool>& pair = projections[i];
 
        this->projected_stop_points.push_back(pair.first);
        if (pair.second) {
@@ -553,9 +579,10 @@ void GeoRef::project_stop_points(const std::vector<type::StopPoint*> &stop_point
 
 void GeoRef::build_admins_stop_points(std::vector<type::StopPoint*> & stop_points){
     auto log = log4cplus::Logger::getInstance("kraken::type::GeoRef::fill_admins_stop_points");
-    int cpt_no_projected = 0;
-    for(type::StopPoint* stop_point : stop_points) {
-        ProjectionData projection = this->projected_stop_points[stop_point->idx][type::Mode_e::Walking];
+    //one counter by thread, summed at the end
+    const auto cpt_no_projected = parallel_for_locals<int>(stop_points.size(), [&](size_t i, int& no_projected) {
+        type::StopPoint* stop_point = stop_points[i];
+        const ProjectionData& projection = this->projected_stop_points[stop_point->idx][type::Mode_e::Walking];
         if(projection.found){
             const edge_t edge = boost::edge(projection[ProjectionData::Direction::Source],
                                          projection[ProjectionData::Direction::Target],
@@ -565,17 +592,22 @@ void GeoRef::build_admins_stop_points(std::vector<type::StopPoint*> & stop_point
                                           way->admin_list.begin(),
                                           way->admin_list.end());
         }else{
-            cpt_no_projected++;
+            no_projected++;
         }
-    }
-    LOG4CPLUS_DEBUG(log, cpt_no_projected<<"/"<<stop_points.size() << " stop_points are not associated with any admins");
+    });
+    LOG4CPLUS_DEBUG(log, std::accumulate(cpt_no_projected.begin(), cpt_no_projected.end(), 0)
+                    <<"/"<<stop_points.size() << " stop_points are not associated with any admins");
 }
 
 void GeoRef::build_admins_pois(){
     auto log = log4cplus::Logger::getInstance("kraken::type::GeoRef::fill_admins_pois");
-    int cpt_no_projected = 0;
-    int cpt_no_initialized = 0;
-    for(POI* poi : this->pois){
+    //counters of each thread, summed at the end
+    struct Counters {
+        int no_projected = 0;
+        int no_initialized = 0;
+    };
+    const auto counters = parallel_for_locals<Counters>(this->pois.size(), [&](size_t i, Counters& cpt) {
+        POI* poi = this->pois[i];
         if(poi->coord.is_initialized()){
             try{
                 edge_t edge = this->nearest_edge(poi->coord);
@@ -583,14 +615,19 @@ void GeoRef::build_admins_pois(){
                 poi->admin_list.insert(poi->admin_list.end(),
                                        way->admin_list.begin(), way->admin_list.end());
             }catch(proximitylist::NotFound){
-                cpt_no_projected++;
+                cpt.no_projected++;
             }
         }else{
-            cpt_no_initialized++;
+            cpt.no_initialized++;
         }
+    });
+    int cpt_no_projected = 0, cpt_no_initialized = 0;
+    for(const Counters& cpt : counters){
+        cpt_no_projected += cpt.no_projected;
+        cpt_no_initialized += cpt.no_initialized;
     }
-    LOG4CPLUS_DEBUG(log, cpt_no_projected<<"/"<<this->pois.size() << " pois are not associated with any admins");
-    LOG4CPLUS_DEBUG(log, cpt_no_initialized<<"/"<<this->pois.size() << " pois with coordinates not initialized");
+    LOG4CPLUS_DEBUG(log, cpt_no_projected <<"/"<<this->pois.size() << " pois are not associated with any admins");
+    LOG4CPLUS_DEBUG(log, cpt_no_initialized <<"/"<<this->pois.size() << " pois with coordinates not initialized");
 }
 
 std::pair<GeoRef::ProjectionByMode, bool> GeoRef::project_stop_point(const type::StopPoint* stop_point) const {
@@ -617,8 +654,22 @@ vertex_t GeoRef::nearest_vertex(const type::GeographicalCoord & coordinates, con
     return prox.find_nearest(coordinates);
 }
 
+/// Construit l'index spatial des arcs de chaque graphe (un par offset, les modes peuvent partager un graphe)
+void GeoRef::build_edge_indexes(){
+    edge_indexes.clear();
+    for(const auto& pair : offsets){
+        if(edge_indexes.find(pair.second) != edge_indexes.end())
+            continue;
+        edge_indexes[pair.second] = std::make_shared<const EdgeIndex>(*this, pair.second, pair.second + nb_vertex_by_mode);
+    }
+}
+
 /// Get the nearest_edge with at least one vertex in the graph corresponding to the offset (walking, bike, ...)
 edge_t GeoRef::nearest_edge(const type::GeographicalCoord & coordinates, type::idx_t offset, const proximitylist::ProximityList<vertex_t>& prox) const {
+    auto it = edge_indexes.find(offset);
+    if(&prox == &this->pl && it != edge_indexes.end()){
+        return it->second->nearest_edge(coordinates);
+    }
     auto vertexes_within = prox.find_within(coordinates);
     for (const auto pair_coord : vertexes_within) {
         //we increment the index to get the vertex in the other graph
@@ -659,6 +710,10 @@ edge_t GeoRef::nearest_edge(const type::GeographicalCoord & coordinates, const v
 
 }
 edge_t GeoRef::nearest_edge(const type::GeographicalCoord & coordinates, const proximitylist::ProximityList<vertex_t> &prox) const {
+    auto it = edge_indexes.find(0);
+    if(&prox == &this->pl && it != edge_indexes.end()){
+        return it->second->nearest_edge(coordinates);
+    }
     vertex_t u = nearest_vertex(coordinates, prox);
     return nearest_edge(coordinates, u);
 }
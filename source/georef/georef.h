@@ -35,12 +35,14 @@ www.navitia.io
 #include "adminref.h"
 #include "utils/exception.h"
 #include "utils/flat_enum_map.h"
+#include "type/lru_cache.h"
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/adj_list_serialize.hpp>
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/utility.hpp>
 #include <map>
+#include <tuple>
 
 
 namespace nt = navitia::type;
@@ -201,6 +203,24 @@ struct Path {
 
 class ProjectionData;
 
+/** Result of a street network search around a starting point
+  *
+  * It is kept in a cache since lots of requests start from the same places (stations, city halls, ...)
+  */
+struct StopPointNeighbourhood {
+    /// stop points reachable within the radius, with the duration to reach them
+    std::vector<std::pair<nt::idx_t, boost::posix_time::time_duration>> stop_points;
+    /// state of the dijkstra for each vertex reached: vertex, distance and predecessor
+    std::vector<std::tuple<vertex_t, boost::posix_time::time_duration, vertex_t>> visited;
+};
+
+/** mode, speed factor, radius, starting coordinate and generation of the proximity list used for the search
+  *
+  * The georef (and its cache) can be kept across reloads, so the key can't use the address
+  * of the proximity list: a new one could be allocated at the same place
+  */
+typedef std::tuple<nt::Mode_e, float, boost::posix_time::time_duration, nt::GeographicalCoord, uint64_t> NeighbourhoodKey;
+
 /** Rectangle utilisé par RTree pour indexer spatialement les communes */
 struct Rect{
     double min[2];
@@ -226,6 +246,8 @@ struct Rect{
 //Forward declarations
 struct POI;
 struct POIType;
+struct ContractionHierarchy;
+struct EdgeIndex;
 /** Structure contenant tout ce qu'il faut savoir sur le référentiel de voirie */
 struct GeoRef {
 
@@ -279,6 +301,18 @@ struct GeoRef {
     navitia::autocomplete::autocomplete_map synonyms;
     int word_weight = 5; //Pas serialisé : lu dans le fichier ini
 
+    /// Contraction hierarchies of the graph of each transportation mode, not serialized
+    /// they are optional and only built on demand with build_contraction_hierarchies
+    flat_enum_map<nt::Mode_e, std::shared_ptr<const ContractionHierarchy>> contraction_hierarchies;
+
+    /// Spatial index of the edges of each subgraph by offset, not serialized
+    /// built at load with build_edge_indexes, the projections fallback on the nearest vertex without them
+    std::map<nt::idx_t, std::shared_ptr<const EdgeIndex>> edge_indexes;
+
+    /// Cache of the stop points reachable from a starting point, not serialized
+    /// The weight of an entry is its number of visited vertices
+    mutable LruCache<NeighbourhoodKey, StopPointNeighbourhood> neighbourhood_cache {2000000};
+
     void init();
 
     template<class Archive> void save(Archive & ar, const unsigned int) const {
@@ -294,6 +328,7 @@ struct GeoRef {
         ar & ways & way_map & graph & offsets & fl_admin & fl_way & pl & projected_stop_points
                 & admins & admin_map & pois & fl_poi & poitypes &poitype_map & poi_map & synonyms & poi_proximity_list
                 & nb_vertex_by_mode;
+        build_edge_indexes();
     }
     BOOST_SERIALIZATION_SPLIT_MEMBER()
 
@@ -318,6 +353,12 @@ struct GeoRef {
     /// Construit l’indexe spatial permettant de retrouver plus vite la commune à une coordonnées
     void build_rtree();
 
+    /// Construit l'indexe spatial des arcs de chaque mode de transport
+    void build_edge_indexes();
+
+    /// Build the contraction hierarchies of the given transportation modes
+    void build_contraction_hierarchies(const std::vector<nt::Mode_e>& modes);
+
     /// Recherche d'une adresse avec un numéro en utilisant Autocomplete
     std::vector<nf::Autocomplete<nt::idx_t>::fl_quality> find_ways(const std::string & str, const int nbmax, const int search_type,std::function<bool(nt::idx_t)> keep_element) const;
 
@@ -337,8 +378,9 @@ struct GeoRef {
 
     /** Retourne l'arc (segment) le plus proche
       *
-      * Pour le trouver, on cherche le nœud le plus proche, puis pour chaque arc adjacent, on garde le plus proche
-      * Ce n'est donc pas optimal, mais pour améliorer ça, il faudrait indexer des segments, ou ratisser plus large
+      * Si l'indexe des arcs est construit (et qu'on utilise la proximity list du GeoRef), on cherche directement
+      * le segment le plus proche. Sinon, on cherche le nœud le plus proche, puis pour chaque arc adjacent,
+      * on garde le plus proche, ce qui rate les arcs longs dont les extrémités sont loin
      */
 
     vertex_t nearest_vertex(const type::GeographicalCoord & coordinates, const proximitylist::ProximityList<vertex_t> &prox) const;
@@ -29,8 +29,10 @@ www.navitia.io
 */
 
 #include "street_network.h"
+#include "contraction_hierarchy.h"
 #include "type/data.h"
 #include "georef.h"
+#include <algorithm>
 #include <chrono>
 
 namespace navitia { namespace georef {
@@ -57,6 +59,11 @@ void StreetNetwork::init(const type::EntryPoint& start, boost::optional<const ty
     }
 }
 
+void StreetNetwork::set_deadline(const bt::ptime& deadline) {
+    departure_path_finder.deadline = deadline;
+    arrival_path_finder.deadline = deadline;
+}
+
 bool StreetNetwork::departure_launched() const {return departure_path_finder.computation_launch;}
 bool StreetNetwork::arrival_launched() const {return arrival_path_finder.computation_launch;}
 
@@ -120,8 +127,16 @@ Path StreetNetwork::get_path(type::idx_t idx, bool use_second) {
 }
 
 Path StreetNetwork::get_direct_path() {
+    //the hierarchy does not need the searches around the departure and the arrival
+    const auto& ch = geo_ref.contraction_hierarchies[departure_path_finder.mode];
+    if (ch && departure_path_finder.mode == arrival_path_finder.mode
+            && departure_path_finder.speed_factor == arrival_path_finder.speed_factor) {
+        return get_direct_path(*ch);
+    }
+
     if (!departure_launched() || !arrival_launched())
         return {};
+
     //Cherche s'il y a des nœuds en commun, et retient le chemin le plus court
     size_t num_vertices = boost::num_vertices(geo_ref.graph);
 
@@ -149,6 +164,33 @@ Path StreetNetwork::get_direct_path() {
     return result;
 }
 
+Path StreetNetwork::get_direct_path(const ContractionHierarchy& ch) {
+    const auto& start = departure_path_finder.starting_edge;
+    const auto& end = arrival_path_finder.starting_edge;
+    if (! start.found || ! end.found)
+        return {};
+
+    //the searches start from both ends of the projections, with the durations set by PathFinder::init
+    std::vector<std::pair<vertex_t, bt::time_duration>> sources, targets;
+    for (auto d : {source_e, target_e}) {
+        sources.push_back({start[d], departure_path_finder.distances[start[d]]});
+        targets.push_back({end[d], arrival_path_finder.distances[end[d]]});
+    }
+    //the path is not bounded by the radii of the nearest stop points searches
+    auto best = ch.shortest_path(sources, targets, departure_path_finder.speed_factor);
+    if (best.second.empty())
+        return {};
+
+    std::vector<vertex_t> reverse_path(best.second.rbegin(), best.second.rend());
+    Path result = create_path(geo_ref, reverse_path, false);
+    departure_path_finder.add_projections_to_path(result, true);
+    arrival_path_finder.add_projections_to_path(result, false);
+
+    result.path_items.front().angle = 0;
+
+    return result;
+}
+
 PathFinder::PathFinder(const GeoRef& gref) : geo_ref(gref) {}
 
 void PathFinder::init(const type::GeographicalCoord& start_coord, nt::Mode_e mode, const float speed_factor) {
@@ -197,17 +239,43 @@ PathFinder::find_nearest_stop_points(bt::time_duration radius, const proximityli
     if(elements.empty())
         return {};
 
+    // the cache can only be used on a fresh search (ie just after the init)
+    const bool use_cache = ! computation_launch;
+    const NeighbourhoodKey key(mode, speed_factor, radius, start_coord, pl.generation.value);
+    if (use_cache) {
+        if (const auto neighbourhood = geo_ref.neighbourhood_cache.get(key)) {
+            computation_launch = true;
+            //we restore the dijkstra state, the pathes to the stop points will be built from it
+            for (const auto& visited: neighbourhood->visited) {
+                distances[std::get<0>(visited)] = std::get<1>(visited);
+                predecessors[std::get<0>(visited)] = std::get<2>(visited);
+            }
+            return neighbourhood->stop_points;
+        }
+    }
+
     computation_launch = true;
     std::vector<std::pair<type::idx_t, bt::time_duration>> result;
 
     // On lance un dijkstra depuis les deux nœuds de départ
+    // once the deadline passed, the stop points already reached are returned
+    bool complete = true;
+    // the vertices given a distance, only recorded for the cache
+    std::vector<vertex_t> reached;
+    std::vector<vertex_t>* reached_ptr = use_cache ? &reached : nullptr;
     try {
-        dijkstra(starting_edge[source_e], distance_visitor(radius, distances));
-    } catch(DestinationFound){}
+        try {
+            dijkstra(starting_edge[source_e], distance_visitor(radius, distances, reached_ptr));
+        } catch(DestinationFound){}
 
-    try {
-        dijkstra(starting_edge[target_e], distance_visitor(radius, distances));
-    } catch(DestinationFound){}
+        try {
+            dijkstra(starting_edge[target_e], distance_visitor(radius, distances, reached_ptr));
+        } catch(DestinationFound){}
+    } catch(const DeadlineExceeded&) {
+        LOG4CPLUS_DEBUG(log4cplus::Logger::getInstance("Logger"),
+                        "deadline reached, the nearest stop points search is partial");
+        complete = false;
+    }
 
     const auto max = bt::pos_infin;
 
@@ -226,6 +294,21 @@ PathFinder::find_nearest_stop_points(bt::time_duration radius, const proximityli
             }
         }
     }
+
+    // a partial search must not be reused by the next requests
+    if (use_cache && complete) {
+        auto neighbourhood = std::make_shared<StopPointNeighbourhood>();
+        neighbourhood->stop_points = result;
+        //the second search discovers again the vertices of the first one
+        std::sort(reached.begin(), reached.end());
+        reached.erase(std::unique(reached.begin(), reached.end()), reached.end());
+        neighbourhood->visited.reserve(reached.size());
+        for (vertex_t u : reached) {
+            neighbourhood->visited.push_back(std::make_tuple(u, distances[u], predecessors[u]));
+        }
+        const auto weight = std::max(neighbourhood->visited.size(), size_t(1));
+        geo_ref.neighbourhood_cache.insert(key, neighbourhood, weight);
+    }
     return result;
 }
 
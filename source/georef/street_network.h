@@ -30,6 +30,7 @@ www.navitia.io
 
 #pragma once
 #include "georef.h"
+#include "type/deadline.h"
 #include <boost/graph/filtered_graph.hpp>
 #include <boost/graph/two_bit_color_map.hpp>
 #include <boost/graph/dijkstra_shortest_paths.hpp>
@@ -98,6 +99,25 @@ struct TransportationModeFilter {
     }
 };
 
+/// Visitor throwing DeadlineExceeded when the deadline passes, the other events are forwarded
+template<typename Visitor>
+struct deadline_visitor : public Visitor {
+    bt::ptime deadline;
+    size_t check_interval;
+    size_t nb_settled = 0;
+
+    deadline_visitor(const Visitor& visitor, const bt::ptime& deadline, size_t check_interval) :
+        Visitor(visitor), deadline(deadline), check_interval(check_interval){}
+
+    template <typename graph_type>
+    void finish_vertex(vertex_t u, const graph_type& g){
+        if(++nb_settled % check_interval == 0 && deadline_passed(deadline)) {
+            throw DeadlineExceeded();
+        }
+        Visitor::finish_vertex(u, g);
+    }
+};
+
 struct PathFinder {
     const GeoRef & geo_ref;
 
@@ -108,7 +128,7 @@ struct PathFinder {
     ProjectionData starting_edge;
 
     /// Transportation mode
-    nt::Mode_e mode;
+    nt::Mode_e mode = nt::Mode_e::Walking;
     float speed_factor = 0.;
 
     /// Distance array for the Dijkstra
@@ -117,6 +137,10 @@ struct PathFinder {
     /// Predecessors array for the Dijkstra
     std::vector<vertex_t> predecessors;
 
+    /// UTC deadline of the searches, checked every deadline_check_interval settled vertices
+    bt::ptime deadline;
+    static const size_t deadline_check_interval = 1024;
+
     PathFinder(const GeoRef& geo_ref);
 
     /**
@@ -159,7 +183,7 @@ struct PathFinder {
                                                std::less<bt::time_duration>(),
                                                SpeedDistanceCombiner(speed_factor), //we multiply the edge duration by a speed factor
                                                bt::seconds(0),
-                                               visitor,
+                                               deadline_visitor<Visitor>(visitor, deadline, deadline_check_interval),
                                                color
                                                );
     }
@@ -207,14 +231,21 @@ struct StreetNetwork {
     /**
      * Build the direct path between the start and the end by connecting the 2 sub path (from departure and from arrival).
      * If the 2 sub path does not connect return an empty path
+     * With a contraction hierarchy of the mode, the path is searched in the hierarchy and is not bounded by the 2 sub pathes
      **/
     Path get_direct_path();
 
+    /// UTC deadline of the searches of the two path finders
+    void set_deadline(const bt::ptime& deadline);
+
     const GeoRef & geo_ref;
     PathFinder departure_path_finder;
     PathFinder arrival_path_finder;
 
 private:
+    /// Build the direct path with the contraction hierarchy of the transportation mode
+    Path get_direct_path(const ContractionHierarchy& ch);
+
     /// Combine 2 pathes
     Path combine_path(const vertex_t best_destination, std::vector<vertex_t> preds, std::vector<vertex_t> successors) const;
 };
@@ -241,11 +272,20 @@ struct target_visitor : public boost::dijkstra_visitor<> {
 };
 
 // Visiteur qui s'arrête au bout d'une certaine distance
+// Les sommets atteints sont ajoutés à reached s'il est donné
 struct distance_visitor : public boost::dijkstra_visitor<> {
     boost::posix_time::time_duration max_duration;
     const std::vector<bt::time_duration>& durations;
-    distance_visitor(bt::time_duration max_dur, const std::vector<bt::time_duration> & dur) :
-        max_duration(max_dur), durations(dur){}
+    std::vector<vertex_t>* reached;
+    distance_visitor(bt::time_duration max_dur, const std::vector<bt::time_duration> & dur,
+                     std::vector<vertex_t>* reached = nullptr) :
+        max_duration(max_dur), durations(dur), reached(reached){}
+
+    template <typename graph_type>
+    void discover_vertex(vertex_t u, const graph_type&){
+        if(reached != nullptr)
+            reached->push_back(u);
+    }
 
     template <typename graph_type>
     void finish_vertex(vertex_t u, const graph_type&){
@@ -184,6 +184,36 @@ BOOST_AUTO_TEST_CASE(nearest_segment){
     BOOST_CHECK_THROW(sn.nearest_edge(c), navitia::proximitylist::NotFound);
 }
 
+BOOST_AUTO_TEST_CASE(nearest_segment_with_index){
+    GeoRef sn;
+    GraphBuilder b(sn);
+
+    /*                   c
+                         d
+
+          a––––––––––––––x––––––––––––––b      */
+
+    b("a", -400, 0)("b", 400, 0)("c", 0, 300)("d", 0, 250);
+    b("a", "b")("d", "c");
+    sn.init();
+    //only a to b is in the car graph
+    const auto car_offset = sn.offsets[navitia::type::Mode_e::Car];
+    boost::add_edge(b.get("a") + car_offset, b.get("b") + car_offset, Edge(), sn.graph);
+
+    navitia::type::GeographicalCoord c(0, 10, false);
+    //without the index, we only look at the edges of the nearest vertex
+    BOOST_CHECK(sn.nearest_edge(c) == b.get("d", "c"));
+
+    sn.build_edge_indexes();
+    BOOST_CHECK(sn.nearest_edge(c) == b.get("a", "b"));
+    c.set_xy(0, 280);
+    BOOST_CHECK(sn.nearest_edge(c) == b.get("d", "c"));
+    BOOST_CHECK(sn.nearest_edge(c, navitia::type::Mode_e::Car, sn.pl)
+                == boost::edge(b.get("a") + car_offset, b.get("b") + car_offset, sn.graph).first);
+    c.set_xy(5000, 5000);
+    BOOST_CHECK_THROW(sn.nearest_edge(c), navitia::proximitylist::NotFound);
+}
+
 //not used for the moment so it is not possible anymore (but it would not be difficult to do again)
 // Est-ce que le calcul de plusieurs nœuds vers plusieurs nœuds fonctionne
 //BOOST_AUTO_TEST_CASE(compute_route_n_n){
@@ -422,6 +452,128 @@ BOOST_AUTO_TEST_CASE(compute_nearest){
     BOOST_CHECK_EQUAL(res[1].second, bt::seconds(50 / (default_speed[Mode_e::Walking] * 2)) + 150_s);
 }
 
+/**
+  * The second search from the same starting point must be served by the cache
+  * and must leave the path finder in the same state than the real search
+  */
+BOOST_AUTO_TEST_CASE(compute_nearest_with_cache){
+    using namespace navitia::type;
+
+    GeoRef sn;
+    GraphBuilder b(sn);
+
+    b("a",0,0)("b",100,0)("c",200,0)("d",300,0)("e",400,0);
+    b("a","b",100_s)("b","a",100_s)("b","c",100_s)("c","b",100_s)("c","d",100_s)("d","c",100_s)("d","e",100_s)("e","d",100_s);
+
+    GeographicalCoord c1(50,10, false);
+    GeographicalCoord c2(350,20, false);
+    navitia::proximitylist::ProximityList<idx_t> pl;
+    pl.add(c1, 0);
+    pl.add(c2, 1);
+    pl.build();
+    sn.init();
+
+    StopPoint* sp1 = new StopPoint();
+    sp1->coord = c1;
+    StopPoint* sp2 = new StopPoint();
+    sp2->coord = c2;
+    std::vector<StopPoint*> stop_points;
+    stop_points.push_back(sp1);
+    stop_points.push_back(sp2);
+    sn.project_stop_points(stop_points);
+
+    StreetNetwork w(sn);
+    EntryPoint starting_point;
+    starting_point.coordinates = GeographicalCoord(0,0);
+    starting_point.streetnetwork_params.mode = Mode_e::Walking;
+    starting_point.streetnetwork_params.speed_factor = 2;
+
+    w.init(starting_point);
+    auto res = w.find_nearest_stop_points(1000_s, pl, false);
+    BOOST_REQUIRE_EQUAL(res.size(), 2);
+    BOOST_CHECK_EQUAL(sn.neighbourhood_cache.misses(), 1);
+    BOOST_CHECK_EQUAL(sn.neighbourhood_cache.size(), 1);
+    const auto distances = w.departure_path_finder.distances;
+    const auto path = w.get_path(1);
+
+    w.init(starting_point);
+    auto cached_res = w.find_nearest_stop_points(1000_s, pl, false);
+    BOOST_CHECK_EQUAL(sn.neighbourhood_cache.hits(), 1);
+    BOOST_CHECK(res == cached_res);
+    BOOST_CHECK(distances == w.departure_path_finder.distances);
+    const auto cached_path = w.get_path(1);
+    BOOST_CHECK_EQUAL(cached_path.duration, path.duration);
+    BOOST_CHECK_EQUAL(cached_path.path_items.size(), path.path_items.size());
+
+    //another radius is another search
+    w.init(starting_point);
+    res = w.find_nearest_stop_points(100_s, pl, false);
+    BOOST_CHECK_EQUAL(res.size(), 1);
+    BOOST_CHECK_EQUAL(sn.neighbourhood_cache.misses(), 2);
+
+    //a rebuilt proximity list, at the same address, is not served by the cache
+    pl.build();
+    w.init(starting_point);
+    res = w.find_nearest_stop_points(100_s, pl, false);
+    BOOST_CHECK_EQUAL(sn.neighbourhood_cache.misses(), 3);
+}
+
+/**
+  * Once the deadline passed, the search stops after a bounded number of vertices:
+  * the stop points already reached are returned and the partial search is not cached
+  */
+BOOST_AUTO_TEST_CASE(compute_nearest_deadline){
+    using namespace navitia::type;
+
+    GeoRef sn;
+    GraphBuilder b(sn);
+
+    const size_t nb_vertices = 4 * navitia::georef::PathFinder::deadline_check_interval;
+    for(size_t i = 0; i < nb_vertices; ++i){
+        b(std::to_string(i), i * 10, 0);
+    }
+    for(size_t i = 0; i + 1 < nb_vertices; ++i){
+        b(std::to_string(i), std::to_string(i + 1), 10_s)(std::to_string(i + 1), std::to_string(i), 10_s);
+    }
+
+    GeographicalCoord c1(15,5, false);
+    GeographicalCoord c2((nb_vertices - 2) * 10 + 5,5, false);
+    navitia::proximitylist::ProximityList<idx_t> pl;
+    pl.add(c1, 0);
+    pl.add(c2, 1);
+    pl.build();
+    sn.init();
+
+    StopPoint* sp1 = new StopPoint();
+    sp1->coord = c1;
+    StopPoint* sp2 = new StopPoint();
+    sp2->coord = c2;
+    std::vector<StopPoint*> stop_points;
+    stop_points.push_back(sp1);
+    stop_points.push_back(sp2);
+    sn.project_stop_points(stop_points);
+
+    StreetNetwork w(sn);
+    EntryPoint starting_point;
+    starting_point.coordinates = GeographicalCoord(0,0);
+    starting_point.streetnetwork_params.mode = Mode_e::Walking;
+    starting_point.streetnetwork_params.speed_factor = 1;
+
+    w.init(starting_point);
+    w.set_deadline(boost::posix_time::microsec_clock::universal_time() - boost::posix_time::seconds(1));
+    auto res = w.find_nearest_stop_points(bt::hours(24), pl, false);
+    BOOST_REQUIRE_EQUAL(res.size(), 1);
+    BOOST_CHECK_EQUAL(res[0].first, 0);
+    BOOST_CHECK_EQUAL(sn.neighbourhood_cache.size(), 0);
+
+    //without deadline the search is complete
+    w.init(starting_point);
+    w.set_deadline(boost::posix_time::not_a_date_time);
+    res = w.find_nearest_stop_points(bt::hours(24), pl, false);
+    BOOST_CHECK_EQUAL(res.size(), 2);
+    BOOST_CHECK_EQUAL(sn.neighbourhood_cache.size(), 1);
+}
+
 // Récupérer les cordonnées d'un numéro impair :
 BOOST_AUTO_TEST_CASE(numero_impair){
     navitia::georef::Way way;
@@ -36,6 +36,7 @@ www.navitia.io
 #include "type/pt_data.h"
 
 #include"georef/street_network.h"
+#include "georef/contraction_hierarchy.h"
 #include <boost/test/unit_test.hpp>
 
 using namespace navitia::georef;
@@ -173,3 +174,90 @@ BOOST_AUTO_TEST_CASE(idempotence) {
         BOOST_CHECK(first_res == other_res);
     }
 }
+
+/**
+  * The direct path computed with a contraction hierarchy must be the same
+  * than the one computed by combining the departure and arrival searches,
+  * and it does not depend on these searches
+  */
+BOOST_AUTO_TEST_CASE(contraction_hierarchy_direct_path) {
+    type::Data data;
+    GeoRef geo_ref;
+    GraphBuilder b(geo_ref);
+    size_t square_size(10);
+
+    for (size_t i = 0; i < square_size ; ++i) {
+        for (size_t j = 0; j < square_size ; ++j) {
+            b(get_name(i, j), i * 100, j * 100);
+        }
+    }
+    for (size_t i = 0; i < square_size; ++i) {
+        for (size_t j = 0; j < square_size; ++j) {
+            std::string name(get_name(i, j));
+            //the durations are not the same on all edges to have only one shortest path
+            if (j + 1 < square_size) {
+                b.add_edge(name, get_name(i, j + 1), bt::seconds(100 + 7 * i + j), true);
+            }
+            if (i + 1 < square_size) {
+                b.add_edge(name, get_name(i + 1, j), bt::seconds(100 + 3 * j + 5 * i), true);
+            }
+        }
+    }
+
+    type::StopPoint* sp = new type::StopPoint();
+    sp->coord.set_xy(450., 450.);
+    sp->idx = 0;
+    data.pt_data->stop_points.push_back(sp);
+    geo_ref.init();
+    geo_ref.project_stop_points(data.pt_data->stop_points);
+    navitia::proximitylist::ProximityList<type::idx_t> pl;
+    pl.add(sp->coord, sp->idx);
+    pl.build();
+
+    type::EntryPoint origin, destination;
+    origin.coordinates.set_xy(120., 30.);
+    destination.coordinates.set_xy(810., 870.);
+    for (auto ep : {&origin, &destination}) {
+        ep->streetnetwork_params.mode = type::Mode_e::Walking;
+        ep->streetnetwork_params.speed_factor = 1;
+    }
+
+    StreetNetwork sn(geo_ref);
+    sn.init(origin, destination);
+    sn.find_nearest_stop_points(bt::hours(2), pl, false);
+    sn.find_nearest_stop_points(bt::hours(2), pl, true);
+    const auto path = sn.get_direct_path();
+    BOOST_REQUIRE(! path.path_items.empty());
+
+    geo_ref.build_contraction_hierarchies({type::Mode_e::Walking});
+    BOOST_REQUIRE(geo_ref.contraction_hierarchies[type::Mode_e::Walking]);
+
+    sn.init(origin, destination);
+    sn.find_nearest_stop_points(bt::hours(2), pl, false);
+    sn.find_nearest_stop_points(bt::hours(2), pl, true);
+    const auto ch_path = sn.get_direct_path();
+
+    BOOST_CHECK_EQUAL(ch_path.duration, path.duration);
+    BOOST_REQUIRE_EQUAL(ch_path.path_items.size(), path.path_items.size());
+    for (size_t i = 0; i < path.path_items.size(); ++i) {
+        BOOST_CHECK_EQUAL(ch_path.path_items[i].duration, path.path_items[i].duration);
+        BOOST_CHECK(ch_path.path_items[i].coordinates == path.path_items[i].coordinates);
+    }
+
+    //the searches around the departure and the arrival do not meet, the hierarchy still finds the path
+    sn.init(origin, destination);
+    sn.find_nearest_stop_points(bt::seconds(200), pl, false);
+    sn.find_nearest_stop_points(bt::seconds(200), pl, true);
+    BOOST_CHECK_EQUAL(sn.get_direct_path().duration, path.duration);
+
+    //and no search is needed at all
+    sn.init(origin, destination);
+    BOOST_CHECK_EQUAL(sn.get_direct_path().duration, path.duration);
+
+    //without the hierarchy the searches must meet
+    geo_ref.contraction_hierarchies[type::Mode_e::Walking].reset();
+    sn.init(origin, destination);
+    sn.find_nearest_stop_points(bt::seconds(200), pl, false);
+    sn.find_nearest_stop_points(bt::seconds(200), pl, true);
+    BOOST_CHECK(sn.get_direct_path().path_items.empty());
+}
@@ -0,0 +1,144 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+namespace navitia {
+
+/**
+ * File bornée entre deux étages du pipeline de kraken
+ *
+ * push bloque tant que la file est pleine, pop tant qu'elle est vide
+ */
+template<typename T>
+class BlockingQueue {
+    private:
+        mutable std::mutex mutex;
+        std::condition_variable not_empty;
+        std::condition_variable not_full;
+        std::deque<T> queue;
+        const size_t capacity;
+
+    public:
+        explicit BlockingQueue(size_t capacity) : capacity(capacity){}
+
+        void push(T item){
+            std::unique_lock<std::mutex> lock(mutex);
+            not_full.wait(lock, [&](){return queue.size() < capacity;});
+            queue.push_back(std::move(item));
+            not_empty.notify_one();
+        }
+
+        /// N'attend jamais, quitte à dépasser la capacité : pour un producteur qui ne doit pas bloquer
+        void force_push(T item){
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(std::move(item));
+            not_empty.notify_one();
+        }
+
+        T pop(){
+            std::unique_lock<std::mutex> lock(mutex);
+            not_empty.wait(lock, [&](){return !queue.empty();});
+            T item = std::move(queue.front());
+            queue.pop_front();
+            not_full.notify_one();
+            return item;
+        }
+
+        bool full() const{
+            std::lock_guard<std::mutex> lock(mutex);
+            return queue.size() >= capacity;
+        }
+
+        size_t size() const{
+            std::lock_guard<std::mutex> lock(mutex);
+            return queue.size();
+        }
+};
+
+/**
+ * Files bornées par niveau de priorité, 0 étant le niveau le plus prioritaire
+ *
+ * Une requête n'est jamais mise en attente derrière une requête moins prioritaire,
+ * et un niveau plein n'empêche pas les autres de recevoir des requêtes
+ */
+template<typename T>
+class PriorityQueue {
+    private:
+        mutable std::mutex mutex;
+        std::condition_variable not_empty;
+        std::vector<std::deque<T>> queues;
+        const size_t capacity;
+
+    public:
+        /// capacity est la taille maximale de chaque niveau
+        PriorityQueue(size_t nb_levels, size_t capacity) : queues(nb_levels), capacity(capacity){}
+
+        /// Retourne false, sans attendre, si le niveau est plein
+        bool try_push(T item, size_t level){
+            std::lock_guard<std::mutex> lock(mutex);
+            if(queues[level].size() >= capacity){
+                return false;
+            }
+            queues[level].push_back(std::move(item));
+            // the consumers don't all accept every level
+            not_empty.notify_all();
+            return true;
+        }
+
+        /// Attend un élément d'un niveau inférieur ou égal à max_level, le plus prioritaire d'abord
+        T pop(size_t max_level){
+            std::unique_lock<std::mutex> lock(mutex);
+            std::deque<T>* queue = nullptr;
+            not_empty.wait(lock, [&](){
+                for(size_t level = 0; level <= max_level && level < queues.size(); ++level){
+                    if(!queues[level].empty()){
+                        queue = &queues[level];
+                        return true;
+                    }
+                }
+                return false;
+            });
+            T item = std::move(queue->front());
+            queue->pop_front();
+            return item;
+        }
+
+        size_t size(size_t level) const{
+            std::lock_guard<std::mutex> lock(mutex);
+            return queues[level].size();
+        }
+};
+
+}
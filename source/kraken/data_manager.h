@@ -30,23 +30,181 @@ www.navitia.io
 
 #pragma once
 #include <memory>
+#include <functional>
 #include <iostream>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
 
+/**
+ * Publication of the generations of Data
+ *
+ * The current generation is published through an atomic pointer and an epoch
+ * counter. Each worker thread registers a Reader slot in which it announces the
+ * epoch it pins for the duration of a request: pinning only writes into the
+ * slot of the thread, the refcount of the shared_ptr is never touched on the
+ * request path.
+ * When a new generation is published, the old one is retired. It is destroyed
+ * by release_retired once no reader can see it, called by the maintenance
+ * thread after a load and then periodically while has_retired is true: the
+ * loading thread never waits for the readers, and a reader never pays for
+ * the destruction of a generation.
+ */
 template<typename Data>
 class DataManager{
 public:
-    std::shared_ptr<Data> current_data;
+    static const uint64_t unpinned = std::numeric_limits<uint64_t>::max();
 
-    DataManager() : current_data(std::make_shared<Data>()){}
+    /// slot of a reader thread, padded to keep it alone on its cache line
+    struct Reader{
+        std::atomic<uint64_t> epoch;
+        char padding[64 - sizeof(std::atomic<uint64_t>)];
 
-    inline std::shared_ptr<Data> get_data() const{return current_data;}
+        Reader() : epoch(unpinned){}
+    };
 
-    bool load(const std::string& database){
+private:
+    struct Generation{
+        std::shared_ptr<Data> data;
+        uint64_t epoch;
+        Generation(const std::shared_ptr<Data>& data, uint64_t epoch) : data(data), epoch(epoch){}
+    };
+
+public:
+    /**
+     * Pin of the current generation for a reader, released at destruction
+     * A reader must hold only one pin at a time
+     */
+    class Pin{
+        Reader* reader;
+        const Generation* generation;
+    public:
+        Pin(Reader* reader, const Generation* generation) : reader(reader), generation(generation){}
+        Pin(Pin&& other) : reader(other.reader), generation(other.generation){other.reader = nullptr;}
+        Pin(const Pin&) = delete;
+        Pin& operator=(const Pin&) = delete;
+        ~Pin(){
+            if(reader){
+                reader->epoch.store(unpinned);
+            }
+        }
+
+        Data& operator*() const{return *generation->data;}
+        Data* operator->() const{return generation->data.get();}
+        Data* get() const{return generation->data.get();}
+        /// number of the pinned generation, it changes at each publication
+        uint64_t epoch() const{return generation->epoch;}
+    };
+
+    DataManager() : current(nullptr), epoch(0), retired_pending(false){
+        owned.reset(new Generation(std::make_shared<Data>(), 0));
+        current.store(owned.get());
+    }
+
+    /// Register the slot of a reader thread, the slot lives as long as the manager
+    Reader& register_reader(){
+        std::lock_guard<std::mutex> lock(mutex);
+        readers.emplace_back();
+        return readers.back();
+    }
+
+    /**
+     * Pin the current generation for the given reader
+     *
+     * The epoch is announced before the generation is read: a generation
+     * retired at epoch e can only be seen by a reader that announced e or less
+     */
+    Pin pin(Reader& reader) const{
+        reader.epoch.store(epoch.load());
+        return Pin(&reader, current.load());
+    }
+
+    /// Copy of the current data, for the code outside of the request path
+    std::shared_ptr<Data> get_data() const{
+        std::lock_guard<std::mutex> lock(mutex);
+        return current.load()->data;
+    }
+
+    /**
+     * Load the data and swap it with the current one if the load succeeded
+     * The current data is given to the load, so that it can share with the new
+     * one what did not change
+     * prepare is called on the new data before it is published to the workers
+     */
+    bool load(const std::string& database, const std::function<void(Data&)>& prepare = nullptr){
         auto data = std::make_shared<Data>();
-        bool success = data->load(database);
+        const auto previous = get_data();
+        bool success = data->load(database, previous.get());
         if(success){
-            std::swap(current_data, data);
+            if(prepare){
+                prepare(*data);
+            }
+            publish(data);
+            // if a reader still pins the previous generation, it is released later
+            release_retired();
         }
         return success;
     }
+
+    /// Publish a new generation, the previous one is retired
+    void publish(const std::shared_ptr<Data>& data){
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unique_ptr<Generation> next(new Generation(data, owned->epoch + 1));
+        // the generation must be visible before the epoch that announces it
+        current.store(next.get());
+        epoch.store(next->epoch);
+        retired.push_back(std::move(owned));
+        owned = std::move(next);
+        retired_pending.store(true);
+    }
+
+    /// some retired generations are still waiting for their readers
+    bool has_retired() const{return retired_pending.load();}
+
+    /**
+     * Destroy the retired generations no reader can see anymore
+     * Return the number of generations still retired
+     */
+    size_t release_retired(){
+        std::vector<std::unique_ptr<Generation>> released;
+        size_t nb_retired;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            uint64_t min_pinned = unpinned;
+            for(const Reader& reader : readers){
+                min_pinned = std::min(min_pinned, reader.epoch.load());
+            }
+            auto it = retired.begin();
+            while(it != retired.end()){
+                if((*it)->epoch < min_pinned){
+                    released.push_back(std::move(*it));
+                    it = retired.erase(it);
+                }else{
+                    ++it;
+                }
+            }
+            nb_retired = retired.size();
+            retired_pending.store(nb_retired > 0);
+        }
+        // the data are destroyed outside of the lock
+        released.clear();
+        return nb_retired;
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::deque<Reader> readers;
+    std::unique_ptr<Generation> owned;
+    std::vector<std::unique_ptr<Generation>> retired;
+    std::atomic<const Generation*> current;
+    std::atomic<uint64_t> epoch;
+    /// set while there are retired generations, the maintenance thread releases them
+    std::atomic<bool> retired_pending;
 };
+
+template<typename Data>
+const uint64_t DataManager<Data>::unpinned;
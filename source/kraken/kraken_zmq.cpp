@@ -34,6 +34,7 @@ www.navitia.io
 #include <boost/thread.hpp>
 #include <functional>
 #include <string>
+#include <algorithm>
 #include <iostream>
 #include "utils/init.h"
 #include "kraken_zmq.h"
@@ -58,6 +59,7 @@ int main(int, char** argv){
     init_logger(conf_file);
 
     DataManager<navitia::type::Data> data_manager;
+    navitia::WorkerStatePool worker_states;
 
     boost::thread_group threads;
     // Prepare our context and sockets
@@ -65,23 +67,34 @@ int main(int, char** argv){
     zmq::socket_t clients(context, ZMQ_ROUTER);
     std::string zmq_socket = conf->get_as<std::string>("GENERAL", "zmq_socket", "ipc:///tmp/default_navitia");
     clients.bind(zmq_socket.c_str());
-    zmq::socket_t workers(context, ZMQ_DEALER);
-    workers.bind("inproc://workers");
 
-    threads.create_thread(navitia::MaintenanceWorker(data_manager));
+    threads.create_thread(navitia::MaintenanceWorker(data_manager, worker_states));
 
     int nb_threads = conf->get_as<int>("GENERAL", "nb_threads", 1);
+    int nb_encoding_threads = conf->get_as<int>("GENERAL", "nb_encoding_threads", 1);
+    // threads only serving the light apis, at least one thread serves every api
+    int nb_reserved_threads = std::min(conf->get_as<int>("GENERAL", "nb_reserved_threads", 0), nb_threads - 1);
+    // beyond max_queued_requests waiting requests in a priority level, the new ones are rejected
+    const int max_queued_requests = conf->get_as<int>("GENERAL", "max_queued_requests", 1000);
+    navitia::PriorityQueue<RequestJob> requests(nb_priority_levels, std::max(1, max_queued_requests));
+    // the workers wait for the encoders when this queue is full
+    navitia::BlockingQueue<ResponseJob> responses(2 * nb_threads);
+
     // Launch pool of worker threads
     for(int thread_nbr = 0; thread_nbr < nb_threads; ++thread_nbr) {
-        threads.create_thread(std::bind(&doWork, std::ref(context), std::ref(data_manager)));
+        const size_t max_level = thread_nbr < nb_reserved_threads ? 0 : nb_priority_levels - 1;
+        threads.create_thread(std::bind(&doWork, std::ref(requests), std::ref(responses),
+                    std::ref(data_manager), std::ref(worker_states), max_level));
+    }
+
+    // the encoders send the replies to the main thread, which owns the clients socket
+    zmq::socket_t replies(context, ZMQ_PULL);
+    replies.bind("inproc://replies");
+    for(int thread_nbr = 0; thread_nbr < nb_encoding_threads; ++thread_nbr) {
+        threads.create_thread(std::bind(&doEncode, std::ref(context), std::ref(responses)));
     }
 
-    // Connect work threads to client threads via a queue
-    do{
-        try{
-            zmq::device(ZMQ_QUEUE, clients, workers);
-        }catch(zmq::error_t){}//lors d'un SIGHUP on restore la queue
-    }while(true);
+    doIO(clients, replies, requests, responses);
 
     return 0;
 }
@@ -32,57 +32,219 @@ www.navitia.io
 #include "worker.h"
 #include "maintenance_worker.h"
 #include "kraken/data_manager.h"
+#include "kraken/blocking_queue.h"
+#include "type/pb_converter.h"
 #include "utils/logger.h"
 #include <zmq.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace pt = boost::posix_time;
-void doWork(zmq::context_t & context, DataManager<navitia::type::Data>& data_manager) {
+
+/**
+ * Pipeline de traitement des requêtes :
+ *  - le thread principal reçoit les requêtes des clients et décode les protobuf,
+ *  - les threads de calcul (doWork) ne font que le dispatch,
+ *  - les threads d'encodage (doEncode) sérialisent les réponses et les renvoient au thread principal
+ *    qui les transmet aux clients.
+ * Les étages communiquent par des files bornées.
+ * Les requêtes attendent le calcul dans une file par niveau de priorité : les appels légers
+ * (autocomplétion, ptref, ...) passent devant les grilles horaires, qui passent devant les itinéraires.
+ */
+
+const size_t nb_priority_levels = 3;
+
+/// niveau de priorité de l'api, 0 étant le plus prioritaire
+inline size_t priority_level(pbnavitia::API api) {
+    switch(api){
+        case pbnavitia::PLANNER:
+        case pbnavitia::ISOCHRONE:
+            return 2;
+        case pbnavitia::ROUTE_SCHEDULES:
+        case pbnavitia::NEXT_DEPARTURES:
+        case pbnavitia::NEXT_DEPARTURES_BATCH:
+        case pbnavitia::NEXT_ARRIVALS:
+        case pbnavitia::STOPS_SCHEDULES:
+        case pbnavitia::DEPARTURE_BOARDS:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/// niveau de priorité de la requête, celui de sa sous-requête la moins prioritaire pour un batch
+inline size_t priority_level(const pbnavitia::Request& request) {
+    if(request.requested_api() != pbnavitia::BATCH){
+        return priority_level(request.requested_api());
+    }
+    size_t level = 0;
+    for(const pbnavitia::Request& sub_request : request.batch()){
+        level = std::max(level, priority_level(sub_request.requested_api()));
+    }
+    return level;
+}
+
+/// requête décodée, avec l'enveloppe zmq du client
+struct RequestJob {
+    std::vector<std::string> envelope;
+    std::unique_ptr<pbnavitia::Request> request;
+    pt::ptime start;
+};
+
+/// réponse à encoder
+struct ResponseJob {
+    std::vector<std::string> envelope;
+    std::unique_ptr<pbnavitia::Response> response;
+    pbnavitia::API api;
+    pt::ptime start;
+    /// réponse déjà sérialisée (apis cachables), response est alors vide
+    std::shared_ptr<const std::string> payload;
+};
+
+/// max_level est le niveau de priorité le moins prioritaire que traite ce thread
+void doWork(navitia::PriorityQueue<RequestJob>& requests, navitia::BlockingQueue<ResponseJob>& responses,
+        DataManager<navitia::type::Data>& data_manager, navitia::WorkerStatePool& worker_states,
+        size_t max_level) {
     auto logger = log4cplus::Logger::getInstance("worker");
     try{
-        zmq::socket_t socket (context, ZMQ_REP);
-        socket.connect ("inproc://workers");
-        bool run = true;
-        navitia::Worker w(data_manager);
-        while(run) {
-            zmq::message_t request;
-            try{
-                // Wait for next request from client
-                socket.recv(&request);
-            }catch(zmq::error_t){
-                //on gére le cas du sighup durant un recv
-                continue;
+        navitia::Worker w(data_manager, &worker_states);
+        while(true) {
+            RequestJob job = requests.pop(max_level);
+            const pbnavitia::API api = job.request->requested_api();
+            if(api != pbnavitia::METADATAS){
+                // the macro only builds the DebugString if the level is enabled
+                LOG4CPLUS_DEBUG(logger, "receive request: " << job.request->DebugString());
+            }
+            ResponseJob result;
+            result.envelope = std::move(job.envelope);
+            if(navitia::is_cacheable(api)){
+                // serialized here to be kept in the response cache of the generation
+                result.payload = w.dispatch_serialized(*job.request);
+            }else{
+                result.response = std::unique_ptr<pbnavitia::Response>(new pbnavitia::Response());
+                w.dispatch(*job.request).Swap(result.response.get());
             }
+            result.api = api;
+            result.start = job.start;
+            job.request = nullptr;
+            responses.push(std::move(result));
+        }
+    }catch(const std::exception& e){
+        LOG4CPLUS_ERROR(logger, "worker die: " << e.what());
+    }
+}
 
-            pbnavitia::Request pb_req;
-            pbnavitia::Response result;
-            pt::ptime start = pt::microsec_clock::local_time();
-            pbnavitia::API api = pbnavitia::UNKNOWN_API;
-            if(pb_req.ParseFromArray(request.data(), request.size())){
-                /*auto*/ api = pb_req.requested_api();
-                if(api != pbnavitia::METADATAS){
-                    LOG4CPLUS_DEBUG(logger, "receive request: "
-                            << pb_req.DebugString());
-                }
-                result = w.dispatch(pb_req);
-                if(api != pbnavitia::METADATAS){
-                   LOG4CPLUS_TRACE(logger, "response: " << result.DebugString());
-                }
+void doEncode(zmq::context_t & context, navitia::BlockingQueue<ResponseJob>& responses) {
+    auto logger = log4cplus::Logger::getInstance("worker");
+    try{
+        zmq::socket_t socket(context, ZMQ_PUSH);
+        socket.connect("inproc://replies");
+        while(true) {
+            ResponseJob job = responses.pop();
+            if(job.response && job.api != pbnavitia::METADATAS){
+                LOG4CPLUS_TRACE(logger, "response: " << job.response->DebugString());
+            }
+            for(const std::string& frame : job.envelope){
+                zmq::message_t message(frame.size());
+                memcpy(message.data(), frame.data(), frame.size());
+                socket.send(message, ZMQ_SNDMORE);
+            }
+            if(job.payload){
+                zmq::message_t reply(job.payload->size());
+                memcpy(reply.data(), job.payload->data(), job.payload->size());
+                job.payload = nullptr;
+                socket.send(reply);
             }else{
-               LOG4CPLUS_WARN(logger, "receive invalid protobuf");
-               result.mutable_error()->set_id(
-                       pbnavitia::Error::invalid_protobuf_request);
+                zmq::message_t reply(job.response->ByteSize());
+                job.response->SerializeToArray(reply.data(), reply.size());
+                job.response = nullptr;
+                socket.send(reply);
             }
-            zmq::message_t reply(result.ByteSize());
-            result.SerializeToArray(reply.data(), result.ByteSize());
-            socket.send(reply);
 
-            if(api != pbnavitia::METADATAS){
+            if(job.api != pbnavitia::METADATAS){
                 LOG4CPLUS_DEBUG(logger, "processing time : "
-                        << (pt::microsec_clock::local_time() - start).total_milliseconds());
+                        << (pt::microsec_clock::local_time() - job.start).total_milliseconds());
             }
         }
     }catch(const std::exception& e){
-        LOG4CPLUS_ERROR(logger, "worker die: " << e.what());
+        LOG4CPLUS_ERROR(logger, "encoder die: " << e.what());
+    }
+}
+
+/// reçoit tous les frames d'un message multipart, le dernier est le corps
+inline std::vector<zmq::message_t*> recv_multipart(zmq::socket_t& socket, std::vector<std::unique_ptr<zmq::message_t>>& frames) {
+    std::vector<zmq::message_t*> result;
+    int more = 1;
+    while(more){
+        frames.push_back(std::unique_ptr<zmq::message_t>(new zmq::message_t()));
+        socket.recv(frames.back().get());
+        result.push_back(frames.back().get());
+        size_t more_size = sizeof(more);
+        socket.getsockopt(ZMQ_RCVMORE, &more, &more_size);
+    }
+    return result;
+}
+
+/**
+ * Boucle d'entrée/sortie du thread principal
+ *
+ * Une requête dont le niveau de priorité est plein est refusée tout de suite
+ * Ce thread est le seul à lire les réponses des encodeurs : il ne doit jamais attendre
+ * de place dans la file des réponses, ses réponses d'erreur y sont ajoutées sans limite
+ */
+void doIO(zmq::socket_t& clients, zmq::socket_t& replies,
+        navitia::PriorityQueue<RequestJob>& requests, navitia::BlockingQueue<ResponseJob>& responses) {
+    auto logger = log4cplus::Logger::getInstance("worker");
+    while(true) {
+        zmq::pollitem_t items[] = {
+            {static_cast<void*>(replies), 0, ZMQ_POLLIN, 0},
+            {static_cast<void*>(clients), 0, ZMQ_POLLIN, 0}
+        };
+        try{
+            zmq::poll(items, 2, -1);
+
+            if(items[0].revents & ZMQ_POLLIN){
+                std::vector<std::unique_ptr<zmq::message_t>> frames;
+                const auto parts = recv_multipart(replies, frames);
+                for(size_t i = 0; i < parts.size(); ++i){
+                    clients.send(*parts[i], i + 1 < parts.size() ? ZMQ_SNDMORE : 0);
+                }
+            }
+
+            if(items[1].revents & ZMQ_POLLIN){
+                std::vector<std::unique_ptr<zmq::message_t>> frames;
+                const auto parts = recv_multipart(clients, frames);
+                std::vector<std::string> envelope;
+                for(size_t i = 0; i + 1 < parts.size(); ++i){
+                    envelope.push_back(std::string(static_cast<const char*>(parts[i]->data()), parts[i]->size()));
+                }
+                const zmq::message_t& body = *parts.back();
+                const pt::ptime start = pt::microsec_clock::local_time();
+                std::unique_ptr<pbnavitia::Request> request(new pbnavitia::Request());
+                if(request->ParseFromArray(body.data(), body.size())){
+                    const pbnavitia::API api = request->requested_api();
+                    const size_t level = priority_level(*request);
+                    RequestJob job = {envelope, std::move(request), start};
+                    if(!requests.try_push(std::move(job), level)){
+                        LOG4CPLUS_WARN(logger, "too many requests of level " << level << ", request rejected");
+                        std::unique_ptr<pbnavitia::Response> result(new pbnavitia::Response());
+                        navitia::fill_pb_error(pbnavitia::Error::service_unavailable, "Too many requests",
+                                result->mutable_error());
+                        responses.force_push({std::move(envelope), std::move(result), api, start});
+                    }
+                }else{
+                    LOG4CPLUS_WARN(logger, "receive invalid protobuf");
+                    std::unique_ptr<pbnavitia::Response> result(new pbnavitia::Response());
+                    result->mutable_error()->set_id(pbnavitia::Error::invalid_protobuf_request);
+                    responses.force_push({std::move(envelope), std::move(result), pbnavitia::UNKNOWN_API, start});
+                }
+            }
+        }catch(const zmq::error_t&){
+            //on gére le cas du sighup durant un recv
+            continue;
+        }
     }
 }
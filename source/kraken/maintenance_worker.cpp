@@ -29,12 +29,18 @@ www.navitia.io
 */
 
 #include "maintenance_worker.h"
+#include "realtime.h"
 
 #include "utils/configuration.h"
 
 #include <sys/stat.h>
 #include <signal.h>
 #include "type/task.pb.h"
+#include "georef/georef.h"
+#include <boost/algorithm/string.hpp>
+#include <google/protobuf/text_format.h>
+#include <fstream>
+#include <algorithm>
 
 namespace nt = navitia::type;
 namespace pt = boost::posix_time;
@@ -48,10 +54,95 @@ void MaintenanceWorker::load(){
     Configuration * conf = Configuration::get();
     std::string database = conf->get_as<std::string>("GENERAL", "database", "IdF.nav");
     LOG4CPLUS_INFO(logger, "Chargement des données à partir du fichier " + database);
-    if(this->data_manager.load(database)){
-        auto data = data_manager.get_data();
+    auto prepare = [&](type::Data& data){
+        data.geo_ref->neighbourhood_cache.set_max_weight(
+                conf->get_as<int>("GENERAL", "neighbourhood_cache_size", 2000000));
+        data.response_cache.set_max_weight(
+                conf->get_as<int>("GENERAL", "response_cache_size", 64 * 1024 * 1024));
+        const int day_index_days = conf->get_as<int>("GENERAL", "day_index_days", 0);
+        data.day_index_days = day_index_days;
+        // the two versions of a day, with and without the disruptions
+        data.day_index_cache.set_max_weight(2 * day_index_days);
+
+        std::string ch_modes = conf->get_as<std::string>("GENERAL", "contraction_hierarchies", "");
+        std::vector<std::string> captions;
+        boost::algorithm::split(captions, ch_modes, boost::algorithm::is_any_of(", "), boost::algorithm::token_compress_on);
+        std::vector<type::Mode_e> modes;
+        for(const std::string& caption : captions){
+            if(caption.empty()){
+                continue;
+            }
+            try{
+                modes.push_back(type::static_data::get()->modeByCaption(caption));
+            }catch(const std::out_of_range&){
+                LOG4CPLUS_WARN(logger, "unknown mode for the contraction hierarchies: " << caption);
+            }
+        }
+        // a georef shared with the current data already has its hierarchies, and is being read
+        if(data.geo_ref != data_manager.get_data()->geo_ref){
+            data.geo_ref->build_contraction_hierarchies(modes);
+        }
 
+        prune_trip_updates(trip_updates, bg::day_clock::local_day());
+        if(!trip_updates.empty()){
+            // les index des courses changent d'une donnée à l'autre, l'overlay est reconstruit
+            std::vector<pbnavitia::realtime::TripUpdate> updates;
+            for(const auto& key_update : trip_updates){
+                updates.push_back(key_update.second);
+            }
+            data.set_realtime_overlay(navitia::apply_trip_updates(data, type::RealtimeOverlay(), updates, logger));
+        }
+        this->prepare_worker_states(data);
+    };
+    this->data_manager.load(database, prepare);
+}
+
+
+/// one request per line in the protobuf text format, # for comments
+static std::vector<pbnavitia::Request> load_warm_up_requests(const std::string& filename,
+        log4cplus::Logger& logger){
+    std::vector<pbnavitia::Request> requests;
+    if(filename.empty()){
+        return requests;
+    }
+    std::ifstream file(filename);
+    if(!file){
+        LOG4CPLUS_WARN(logger, "unable to open the warm up requests " << filename);
+        return requests;
     }
+    std::string line;
+    while(std::getline(file, line)){
+        boost::algorithm::trim(line);
+        if(line.empty() || line[0] == '#'){
+            continue;
+        }
+        pbnavitia::Request request;
+        if(google::protobuf::TextFormat::ParseFromString(line, &request)){
+            requests.push_back(request);
+        }else{
+            LOG4CPLUS_WARN(logger, "invalid warm up request: " << line);
+        }
+    }
+    return requests;
+}
+
+
+void MaintenanceWorker::prepare_worker_states(type::Data& data){
+    Configuration * conf = Configuration::get();
+    int nb_threads = conf->get_as<int>("GENERAL", "nb_threads", 1);
+    const auto requests = load_warm_up_requests(
+            conf->get_as<std::string>("GENERAL", "warm_up_requests", ""), logger);
+    auto start = pt::microsec_clock::local_time();
+
+    Worker worker(data_manager);
+    std::vector<std::unique_ptr<WorkerState>> states;
+    for(int i = 0; i < nb_threads; ++i){
+        states.push_back(worker.warm_up(data, requests));
+    }
+    worker_states.reset(std::move(states));
+    LOG4CPLUS_INFO(logger, nb_threads << " worker states prepared with "
+            << requests.size() << " warm up requests in "
+            << (pt::microsec_clock::local_time() - start).total_milliseconds() << "ms");
 }
 
 
@@ -68,17 +159,50 @@ void MaintenanceWorker::operator()(){
                     + ex.what());
             data_manager.get_data()->is_connected_to_rabbitmq = false;
             sleep(10);
+            data_manager.release_retired();
         }
     }
 }
 
+void MaintenanceWorker::apply_trip_updates(const std::vector<pbnavitia::realtime::TripUpdate>& pending){
+    if(pending.empty()){
+        return;
+    }
+    auto start = pt::microsec_clock::local_time();
+    record_trip_updates(trip_updates, pending);
+    prune_trip_updates(trip_updates, bg::day_clock::local_day());
+    // copy-on-write : les requêtes en cours gardent l'overlay qu'elles lisent
+    auto data = data_manager.get_data();
+    data->set_realtime_overlay(navitia::apply_trip_updates(*data, *data->get_realtime_overlay(), pending, logger));
+    LOG4CPLUS_DEBUG(logger, pending.size() << " trip updates applied in "
+            << (pt::microsec_clock::local_time() - start).total_milliseconds() << "ms");
+}
+
 void MaintenanceWorker::listen_rabbitmq(){
+    Configuration * conf = Configuration::get();
+    // un trip update attend au plus realtime_batch_ms avant d'être publié
+    TripUpdateBatch batch(conf->get_as<int>("GENERAL", "realtime_batch_size", 1000),
+                          pt::milliseconds(conf->get_as<int>("GENERAL", "realtime_batch_ms", 500)));
     auto consumer_tag = this->channel->BasicConsume(this->queue_name);
 
     LOG4CPLUS_INFO(logger, "start event loop");
     data_manager.get_data()->is_connected_to_rabbitmq = true;
     while(true){
-        auto envelope = this->channel->BasicConsumeMessage(consumer_tag);
+        // les anciennes données sont détruites ici, pas par le dernier worker qui les lisait
+        if(data_manager.has_retired()){
+            data_manager.release_retired();
+        }
+        int timeout = batch.timeout_ms(pt::microsec_clock::universal_time());
+        if(data_manager.has_retired() && (timeout < 0 || timeout > retired_check_ms)){
+            timeout = retired_check_ms;
+        }
+        AmqpClient::Envelope::ptr_t envelope;
+        if(!this->channel->BasicConsumeMessage(consumer_tag, envelope, timeout)){
+            if(batch.due(pt::microsec_clock::universal_time())){
+                this->apply_trip_updates(batch.take());
+            }
+            continue;
+        }
         LOG4CPLUS_TRACE(logger, "Message received");
         pbnavitia::Task task;
         bool result = task.ParseFromString(envelope->Message()->Body());
@@ -86,6 +210,9 @@ void MaintenanceWorker::listen_rabbitmq(){
             LOG4CPLUS_WARN(logger, "protobuf not valid!");
             continue;
         }
+        if(batch.receive(task, pt::microsec_clock::universal_time())){
+            this->apply_trip_updates(batch.take());
+        }
         if(task.action() == pbnavitia::RELOAD){
             load();
         }
@@ -117,8 +244,10 @@ void MaintenanceWorker::init_rabbitmq(){
     LOG4CPLUS_DEBUG(logger, "connected to rabbitmq");
 }
 
-MaintenanceWorker::MaintenanceWorker(DataManager<type::Data>& data_manager) :
+MaintenanceWorker::MaintenanceWorker(DataManager<type::Data>& data_manager,
+        WorkerStatePool& worker_states) :
         data_manager(data_manager),
+        worker_states(worker_states),
         logger(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("background"))){}
 
 }
@@ -33,7 +33,10 @@ www.navitia.io
 #include <SimpleAmqpClient/SimpleAmqpClient.h>
 #include "type/data.h"
 #include "kraken/data_manager.h"
+#include "kraken/worker.h"
+#include "kraken/realtime.h"
 
+#include <map>
 #include <memory>
 
 
@@ -42,17 +45,28 @@ namespace navitia {
 class MaintenanceWorker{
     private:
         DataManager<type::Data>& data_manager;
+        WorkerStatePool& worker_states;
         log4cplus::Logger logger;
 
         AmqpClient::Channel::ptr_t channel;
         //nom de la queue créer pour ce worker
         std::string queue_name;
 
+        /// période (ms) de destruction des données remplacées encore lues par des workers
+        static const int retired_check_ms = 1000;
+
+        /// dernier trip update reçu par course et jour de circulation, réappliqués à chaque rechargement
+        TripUpdates trip_updates;
+
         void init_rabbitmq();
         void listen_rabbitmq();
+        /// publie une nouvelle génération de l'overlay temps réel avec les trip updates en attente
+        void apply_trip_updates(const std::vector<pbnavitia::realtime::TripUpdate>& pending);
+        /// build the search states of the workers on the data before its publication
+        void prepare_worker_states(type::Data& data);
 
     public:
-        MaintenanceWorker(DataManager<type::Data>& data_manager);
+        MaintenanceWorker(DataManager<type::Data>& data_manager, WorkerStatePool& worker_states);
 
         bool load_and_switch();
 
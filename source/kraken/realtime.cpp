@@ -0,0 +1,158 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#include "realtime.h"
+#include "type/data.h"
+#include "type/pt_data.h"
+#include "type/meta_data.h"
+
+#include <boost/date_time/gregorian/gregorian.hpp>
+#include <algorithm>
+
+namespace bg = boost::gregorian;
+namespace pt = boost::posix_time;
+
+namespace navitia {
+
+/// jour de circulation en jours depuis le début de la production, -1 s'il n'est pas valide
+static int production_day(const type::Data& data, const std::string& circulation_date){
+    bg::date date;
+    try{
+        date = bg::from_undelimited_string(circulation_date);
+    }catch(const std::exception&){
+        return -1;
+    }
+    if(!data.meta->production_date.contains(date)){
+        return -1;
+    }
+    return (date - data.meta->production_date.begin()).days();
+}
+
+std::shared_ptr<type::RealtimeOverlay> apply_trip_updates(const type::Data& data,
+        const type::RealtimeOverlay& overlay,
+        const std::vector<pbnavitia::realtime::TripUpdate>& trip_updates,
+        log4cplus::Logger& logger){
+    auto result = std::make_shared<type::RealtimeOverlay>(overlay);
+    for(const auto& trip_update : trip_updates){
+        auto it = data.pt_data->vehicle_journeys_map.find(trip_update.vehicle_journey_uri());
+        if(it == data.pt_data->vehicle_journeys_map.end()){
+            LOG4CPLUS_DEBUG(logger, "trip update on an unknown vehicle journey: "
+                    << trip_update.vehicle_journey_uri());
+            continue;
+        }
+        const type::VehicleJourney* vj = it->second;
+        const int day = production_day(data, trip_update.circulation_date());
+        if(day < 0){
+            LOG4CPLUS_DEBUG(logger, "trip update on " << vj->uri << " out of the production: "
+                    << trip_update.circulation_date());
+            continue;
+        }
+
+        if(trip_update.delay() > max_trip_update_delay || trip_update.delay() < -max_trip_update_delay){
+            LOG4CPLUS_WARN(logger, "trip update on " << vj->uri << " with an invalid delay: "
+                    << trip_update.delay());
+            continue;
+        }
+
+        type::TripUpdate update;
+        update.cancelled = trip_update.cancelled();
+        update.delay = trip_update.delay();
+        for(const std::string& stop_point_uri : trip_update.skipped_stop_point_uris()){
+            for(const type::StopTime* st : vj->stop_time_list){
+                if(st->journey_pattern_point->stop_point->uri == stop_point_uri){
+                    update.skipped_orders.push_back(st->journey_pattern_point->order);
+                }
+            }
+        }
+        std::sort(update.skipped_orders.begin(), update.skipped_orders.end());
+
+        if(update == type::TripUpdate()){
+            result->erase(vj, day);
+        }else{
+            result->set(vj, day, update);
+        }
+    }
+    return result;
+}
+
+void record_trip_updates(TripUpdates& trip_updates, const std::vector<pbnavitia::realtime::TripUpdate>& updates){
+    for(const auto& update : updates){
+        const auto key = std::make_pair(update.vehicle_journey_uri(), update.circulation_date());
+        if(!update.cancelled() && update.delay() == 0 && update.skipped_stop_point_uris_size() == 0){
+            trip_updates.erase(key);
+        }else{
+            trip_updates[key] = update;
+        }
+    }
+}
+
+void prune_trip_updates(TripUpdates& trip_updates, const bg::date& today){
+    const bg::date yesterday = today - bg::days(1);
+    for(auto it = trip_updates.begin(); it != trip_updates.end();){
+        bool passed = true;
+        try{
+            passed = bg::from_undelimited_string(it->first.second) < yesterday;
+        }catch(const std::exception&){}
+        if(passed){
+            it = trip_updates.erase(it);
+        }else{
+            ++it;
+        }
+    }
+}
+
+bool TripUpdateBatch::receive(const pbnavitia::Task& task, const pt::ptime& now){
+    if(task.action() == pbnavitia::RELOAD){
+        return !pending.empty();
+    }
+    if(task.action() != pbnavitia::TRIP_UPDATE || task.trip_updates_size() == 0){
+        return false;
+    }
+    if(pending.empty()){
+        batch_end = now + batch_duration;
+    }
+    pending.insert(pending.end(), task.trip_updates().begin(), task.trip_updates().end());
+    return pending.size() >= batch_size;
+}
+
+int TripUpdateBatch::timeout_ms(const pt::ptime& now) const{
+    if(pending.empty()){
+        return -1;
+    }
+    return std::max<int64_t>(0, (batch_end - now).total_milliseconds());
+}
+
+std::vector<pbnavitia::realtime::TripUpdate> TripUpdateBatch::take(){
+    std::vector<pbnavitia::realtime::TripUpdate> result;
+    result.swap(pending);
+    return result;
+}
+
+}
@@ -0,0 +1,110 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+#include "type/realtime_overlay.h"
+#include "type/realtime.pb.h"
+#include "type/task.pb.h"
+
+#include <log4cplus/logger.h>
+#include <boost/date_time/gregorian/gregorian_types.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace navitia { namespace type {
+class Data;
+}
+
+/// plus grand retard ou avance (en secondes) accepté sur une course
+const int32_t max_trip_update_delay = 6 * 3600;
+
+/** Nouvelle génération de l'overlay : copie de overlay sur laquelle sont appliqués les trip updates
+  *
+  * overlay n'est pas modifiée, les requêtes en cours continuent de la lire.
+  * Les mises à jour sont appliquées dans l'ordre, une course sans écart est remise à l'heure.
+  * Les mises à jour sur une course inconnue ou un jour hors production sont ignorées,
+  * comme celles dont le retard ou l'avance dépasse max_trip_update_delay.
+  */
+std::shared_ptr<type::RealtimeOverlay> apply_trip_updates(const type::Data& data,
+        const type::RealtimeOverlay& overlay,
+        const std::vector<pbnavitia::realtime::TripUpdate>& trip_updates,
+        log4cplus::Logger& logger);
+
+/// dernier trip update reçu par course et jour de circulation (YYYYMMDD)
+typedef std::map<std::pair<std::string, std::string>, pbnavitia::realtime::TripUpdate> TripUpdates;
+
+/// retient les trip updates à réappliquer au rechargement, une course remise à l'heure est oubliée
+void record_trip_updates(TripUpdates& trip_updates, const std::vector<pbnavitia::realtime::TripUpdate>& updates);
+
+/** Oublie les trip updates des jours de circulation passés
+  *
+  * Ceux de la veille de today sont gardés : la course peut circuler après minuit.
+  */
+void prune_trip_updates(TripUpdates& trip_updates, const boost::gregorian::date& today);
+
+/** Trip updates reçus en attente de publication
+  *
+  * Le lot est publié quand il atteint batch_size trip updates, ou batch_duration après
+  * la réception du premier : chaque trip update ne crée pas sa propre génération de l'overlay.
+  */
+class TripUpdateBatch {
+public:
+    TripUpdateBatch(size_t batch_size, const boost::posix_time::time_duration& batch_duration) :
+        batch_size(batch_size), batch_duration(batch_duration) {}
+
+    /** Range les trip updates de la tâche reçue à now
+      *
+      * Renvoie true si le lot doit être publié avant de continuer : il est plein, ou la tâche est
+      * un rechargement qui doit retrouver les trip updates en attente.
+      */
+    bool receive(const pbnavitia::Task& task, const boost::posix_time::ptime& now);
+
+    bool empty() const { return pending.empty(); }
+
+    /// le plus vieux trip update a attendu batch_duration
+    bool due(const boost::posix_time::ptime& now) const { return !pending.empty() && now >= batch_end; }
+
+    /// attente (ms) avant que le lot soit dû, -1 s'il est vide
+    int timeout_ms(const boost::posix_time::ptime& now) const;
+
+    /// vide le lot, les trip updates sont dans l'ordre de réception
+    std::vector<pbnavitia::realtime::TripUpdate> take();
+
+private:
+    size_t batch_size;
+    boost::posix_time::time_duration batch_duration;
+    std::vector<pbnavitia::realtime::TripUpdate> pending;
+    boost::posix_time::ptime batch_end;
+};
+
+}
@@ -37,7 +37,7 @@ www.navitia.io
 //mock of navitia::type::Data class
 class Data{
     public:
-        bool load(const std::string&){return load_status;}
+        bool load(const std::string&, const Data*){return load_status;}
         static bool load_status;
         static bool destructor_called;
 
@@ -98,4 +98,56 @@ BOOST_AUTO_TEST_CASE(destructor_called){
     BOOST_CHECK(data_manager.get_data());
 }
 
+BOOST_AUTO_TEST_CASE(pin_current_generation){
+    DataManager<Data> data_manager;
+    auto& reader = data_manager.register_reader();
+    uint64_t first_epoch;
+    {
+        auto pin = data_manager.pin(reader);
+        BOOST_CHECK_EQUAL(pin.get(), data_manager.get_data().get());
+        BOOST_CHECK_EQUAL(reader.epoch.load(), pin.epoch());
+        first_epoch = pin.epoch();
+    }
+    BOOST_CHECK_EQUAL(reader.epoch.load(), DataManager<Data>::unpinned);
+    BOOST_CHECK(data_manager.load(""));
+    auto pin = data_manager.pin(reader);
+    BOOST_CHECK_EQUAL(pin.get(), data_manager.get_data().get());
+    BOOST_CHECK_EQUAL(pin.epoch(), first_epoch + 1);
+}
+
+BOOST_AUTO_TEST_CASE(pinned_generation_kept){
+    DataManager<Data> data_manager;
+    auto& reader = data_manager.register_reader();
+    auto& other_reader = data_manager.register_reader();
+    {
+        auto pin = data_manager.pin(reader);
+        data_manager.publish(std::make_shared<Data>());
+        BOOST_CHECK_EQUAL(data_manager.release_retired(), 1);
+        BOOST_CHECK_EQUAL(Data::destructor_called, false);
+        // a reader arriving after the publication sees the new generation
+        {
+            auto other_pin = data_manager.pin(other_reader);
+            BOOST_CHECK_NE(other_pin.get(), pin.get());
+            BOOST_CHECK_EQUAL(other_pin.epoch(), pin.epoch() + 1);
+        }
+        BOOST_CHECK_EQUAL(data_manager.release_retired(), 1);
+        BOOST_CHECK_EQUAL(Data::destructor_called, false);
+    }
+    // unpinning does not destroy the generation, the maintenance thread does
+    BOOST_CHECK_EQUAL(Data::destructor_called, false);
+    BOOST_CHECK(data_manager.has_retired());
+    BOOST_CHECK_EQUAL(data_manager.release_retired(), 0);
+    BOOST_CHECK_EQUAL(Data::destructor_called, true);
+    BOOST_CHECK(! data_manager.has_retired());
+}
+
+BOOST_AUTO_TEST_CASE(load_does_not_wait_for_readers){
+    DataManager<Data> data_manager;
+    auto& reader = data_manager.register_reader();
+    auto pin = data_manager.pin(reader);
+    BOOST_CHECK(data_manager.load(""));
+    BOOST_CHECK_EQUAL(Data::destructor_called, false);
+    BOOST_CHECK_NE(pin.get(), data_manager.get_data().get());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
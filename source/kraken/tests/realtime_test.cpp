@@ -0,0 +1,188 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE realtime_test
+#include <boost/test/unit_test.hpp>
+
+#include "kraken/realtime.h"
+#include "time_tables/get_stop_times.h"
+#include "ed/build_helper.h"
+#include "type/pt_data.h"
+#include <limits>
+
+struct logger_initialized {
+    logger_initialized()   { init_logger(); }
+};
+BOOST_GLOBAL_FIXTURE( logger_initialized )
+
+static pbnavitia::realtime::TripUpdate trip_update(const std::string& vj_uri, const std::string& date){
+    pbnavitia::realtime::TripUpdate update;
+    update.set_vehicle_journey_uri(vj_uri);
+    update.set_circulation_date(date);
+    return update;
+}
+
+/// a batch of trip updates builds a new overlay, the published one is not modified
+BOOST_AUTO_TEST_CASE(apply_batch){
+    ed::builder b("20120614");
+    b.vj("A", "11", "", true, "vj:1")("stop1", 8000, 8050)("stop2", 8100, 8150)("stop3", 8200, 8250);
+    b.vj("A", "11", "", true, "vj:2")("stop1", 9000, 9050)("stop2", 9100, 9150)("stop3", 9200, 9250);
+    b.data->pt_data->index();
+    b.data->build_uri();
+    b.data->build_raptor();
+    auto logger = log4cplus::Logger::getInstance("test");
+    const auto* vj1 = b.data->pt_data->vehicle_journeys_map.at("vj:1");
+    const auto* vj2 = b.data->pt_data->vehicle_journeys_map.at("vj:2");
+
+    std::vector<pbnavitia::realtime::TripUpdate> updates;
+    updates.push_back(trip_update("vj:1", "20120614"));
+    updates.back().set_delay(300);
+    updates.push_back(trip_update("vj:2", "20120615"));
+    updates.back().set_cancelled(true);
+    updates.push_back(trip_update("vj:2", "20120614"));
+    updates.back().add_skipped_stop_point_uris("stop2");
+    //ignored: unknown vehicle journey, out of the production, invalid delay
+    updates.push_back(trip_update("vj:unknown", "20120614"));
+    updates.back().set_cancelled(true);
+    updates.push_back(trip_update("vj:1", "20130614"));
+    updates.back().set_cancelled(true);
+    updates.push_back(trip_update("vj:1", "20120615"));
+    updates.back().set_delay(std::numeric_limits<int32_t>::max());
+    updates.push_back(trip_update("vj:2", "20120616"));
+    updates.back().set_delay(-navitia::max_trip_update_delay - 1);
+
+    const auto previous = b.data->get_realtime_overlay();
+    auto overlay = navitia::apply_trip_updates(*b.data, *previous, updates, logger);
+    BOOST_CHECK(previous->empty());
+    BOOST_REQUIRE_EQUAL(overlay->size(), 3);
+    BOOST_REQUIRE(overlay->get(vj1->idx, 0) != nullptr);
+    BOOST_CHECK_EQUAL(overlay->get(vj1->idx, 0)->delay, 300);
+    BOOST_REQUIRE(overlay->get(vj2->idx, 1) != nullptr);
+    BOOST_CHECK(overlay->get(vj2->idx, 1)->cancelled);
+    const auto* skipped = overlay->get(vj2->idx, 0);
+    BOOST_REQUIRE(skipped != nullptr);
+    BOOST_CHECK(!skipped->skips(0));
+    BOOST_CHECK(skipped->skips(1));
+    BOOST_CHECK(!skipped->skips(2));
+    BOOST_CHECK_EQUAL(overlay->max_delay(vj1->journey_pattern->idx), 300);
+    BOOST_CHECK_EQUAL(overlay->max_advance(vj1->journey_pattern->idx), 0);
+    b.data->set_realtime_overlay(overlay);
+
+    //the vehicle journey does not stop at the skipped stop
+    std::vector<navitia::type::idx_t> stop2;
+    for(auto jpp : b.data->pt_data->journey_pattern_points) {
+        if(jpp->stop_point->uri == "stop2")
+            stop2.push_back(jpp->idx);
+    }
+    auto result = navitia::timetables::get_stop_times(stop2, navitia::DateTimeUtils::set(0, 7000),
+            navitia::DateTimeUtils::set(0, 10000), 10, *b.data, false);
+    BOOST_REQUIRE_EQUAL(result.size(), 1);
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::hour(result[0].first), 8150 + 300);
+
+    //an update without any deviation puts the vehicle journey back on time
+    overlay = navitia::apply_trip_updates(*b.data, *overlay, {trip_update("vj:1", "20120614")}, logger);
+    BOOST_CHECK_EQUAL(overlay->size(), 2);
+    BOOST_CHECK(overlay->get(vj1->idx, 0) == nullptr);
+    BOOST_CHECK_EQUAL(overlay->max_delay(vj1->journey_pattern->idx), 0);
+    BOOST_CHECK_EQUAL(b.data->get_realtime_overlay()->size(), 3);
+}
+
+/// the trip updates kept for the reloads forget the passed days and the trips back on time
+BOOST_AUTO_TEST_CASE(record_and_prune){
+    navitia::TripUpdates trip_updates;
+    std::vector<pbnavitia::realtime::TripUpdate> updates;
+    updates.push_back(trip_update("vj:1", "20120612"));
+    updates.back().set_cancelled(true);
+    updates.push_back(trip_update("vj:1", "20120613"));
+    updates.back().set_delay(300);
+    updates.push_back(trip_update("vj:1", "20120614"));
+    updates.back().set_delay(300);
+    updates.push_back(trip_update("vj:2", "20120614"));
+    updates.back().add_skipped_stop_point_uris("stop2");
+    navitia::record_trip_updates(trip_updates, updates);
+    BOOST_CHECK_EQUAL(trip_updates.size(), 4);
+
+    navitia::record_trip_updates(trip_updates, {trip_update("vj:1", "20120614")});
+    BOOST_CHECK_EQUAL(trip_updates.size(), 3);
+    BOOST_CHECK(trip_updates.find({"vj:1", "20120614"}) == trip_updates.end());
+
+    //a trip of the day before may still run after midnight
+    navitia::prune_trip_updates(trip_updates, boost::gregorian::date(2012, 6, 14));
+    BOOST_REQUIRE_EQUAL(trip_updates.size(), 2);
+    BOOST_CHECK(trip_updates.find({"vj:1", "20120613"}) != trip_updates.end());
+    BOOST_CHECK(trip_updates.find({"vj:2", "20120614"}) != trip_updates.end());
+}
+
+static pbnavitia::Task trip_update_task(size_t nb_updates){
+    pbnavitia::Task task;
+    task.set_action(pbnavitia::TRIP_UPDATE);
+    for(size_t i = 0; i < nb_updates; ++i){
+        *task.add_trip_updates() = trip_update("vj:" + std::to_string(i), "20120614");
+    }
+    return task;
+}
+
+/// the trip updates are published by batch: when the batch is full, after a delay, or before a reload
+BOOST_AUTO_TEST_CASE(trip_update_batch){
+    namespace pt = boost::posix_time;
+    const pt::ptime now(boost::gregorian::date(2012, 6, 14), pt::hours(8));
+    navitia::TripUpdateBatch batch(3, pt::milliseconds(500));
+    BOOST_CHECK(batch.empty());
+    BOOST_CHECK_EQUAL(batch.timeout_ms(now), -1);
+    BOOST_CHECK(!batch.due(now));
+
+    //the delay runs from the first trip update received
+    BOOST_CHECK(!batch.receive(trip_update_task(1), now));
+    BOOST_CHECK(!batch.receive(trip_update_task(1), now + pt::milliseconds(300)));
+    BOOST_CHECK_EQUAL(batch.timeout_ms(now + pt::milliseconds(300)), 200);
+    BOOST_CHECK(!batch.due(now + pt::milliseconds(499)));
+    BOOST_CHECK(batch.due(now + pt::milliseconds(500)));
+    BOOST_CHECK_EQUAL(batch.timeout_ms(now + pt::seconds(1)), 0);
+    BOOST_CHECK_EQUAL(batch.take().size(), 2);
+    BOOST_CHECK(batch.empty());
+    BOOST_CHECK(!batch.due(now + pt::seconds(1)));
+
+    //a full batch is published at once, in the order received
+    BOOST_CHECK(!batch.receive(trip_update_task(2), now + pt::seconds(2)));
+    BOOST_CHECK(batch.receive(trip_update_task(2), now + pt::seconds(2)));
+    auto updates = batch.take();
+    BOOST_REQUIRE_EQUAL(updates.size(), 4);
+    BOOST_CHECK_EQUAL(updates[1].vehicle_journey_uri(), "vj:1");
+    BOOST_CHECK_EQUAL(updates[2].vehicle_journey_uri(), "vj:0");
+
+    //a reload publishes the pending trip updates first, so they are applied on the new data
+    pbnavitia::Task reload;
+    reload.set_action(pbnavitia::RELOAD);
+    BOOST_CHECK(!batch.receive(reload, now + pt::seconds(3)));
+    BOOST_CHECK(!batch.receive(trip_update_task(1), now + pt::seconds(3)));
+    BOOST_CHECK(batch.receive(reload, now + pt::seconds(3)));
+    BOOST_CHECK_EQUAL(batch.take().size(), 1);
+}
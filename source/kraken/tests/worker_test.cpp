@@ -0,0 +1,178 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE worker_test
+#include <boost/test/unit_test.hpp>
+
+#include "kraken/worker.h"
+#include "ed/build_helper.h"
+#include "type/pt_data.h"
+
+struct logger_initialized {
+    logger_initialized()   { init_logger(); }
+};
+BOOST_GLOBAL_FIXTURE( logger_initialized )
+
+static pbnavitia::Request ptref_request(const std::vector<std::string>& forbidden){
+    pbnavitia::Request request;
+    request.set_requested_api(pbnavitia::PTREFERENTIAL);
+    auto* ptref = request.mutable_ptref();
+    ptref->set_requested_type(pbnavitia::LINE);
+    ptref->set_filter("");
+    ptref->set_depth(1);
+    ptref->set_start_page(0);
+    ptref->set_count(10);
+    for(const auto& uri : forbidden){
+        ptref->add_forbidden_uri(uri);
+    }
+    return request;
+}
+
+/// the key does not depend on the fields not changing the response
+BOOST_AUTO_TEST_CASE(canonical_cache_key){
+    auto request = ptref_request({"line:A", "line:B"});
+    auto other = ptref_request({"line:B", "line:A"});
+    other.set_deadline(42);
+    //a sub request of another api is ignored
+    other.mutable_place_uri()->set_uri("stop_area:stop1");
+    BOOST_CHECK_EQUAL(navitia::response_cache_key(request), navitia::response_cache_key(other));
+
+    auto different = ptref_request({"line:A"});
+    BOOST_CHECK(navitia::response_cache_key(request) != navitia::response_cache_key(different));
+}
+
+/// the second identical request is served by the cache of the generation
+BOOST_AUTO_TEST_CASE(cached_response){
+    ed::builder b("20120614");
+    b.vj("A")("stop_area:stop1", 8*3600 +10*60, 8*3600 + 11 * 60)("stop_area:stop2", 8*3600 + 20 * 60 ,8*3600 + 21*60);
+    b.generate_dummy_basis();
+    b.data->pt_data->index();
+    b.data->build_uri();
+    b.data->loaded = true;
+
+    DataManager<navitia::type::Data> data_manager;
+    std::shared_ptr<navitia::type::Data> data(b.data.release());
+    data_manager.publish(data);
+    navitia::Worker w(data_manager);
+
+    const auto request = ptref_request({});
+    BOOST_REQUIRE(navitia::is_cacheable(request.requested_api()));
+    const auto payload = w.dispatch_serialized(request);
+    BOOST_CHECK_EQUAL(data->response_cache.misses(), 1);
+    const auto cached = w.dispatch_serialized(request);
+    BOOST_CHECK_EQUAL(data->response_cache.hits(), 1);
+    BOOST_CHECK_EQUAL(*payload, *cached);
+
+    pbnavitia::Response response;
+    BOOST_REQUIRE(response.ParseFromString(*cached));
+    BOOST_CHECK_EQUAL(response.lines_size(), 1);
+
+    //the responses computed before a realtime update are not served anymore
+    data->set_realtime_overlay(std::make_shared<navitia::type::RealtimeOverlay>());
+    w.dispatch_serialized(request);
+    BOOST_CHECK_EQUAL(data->response_cache.misses(), 2);
+    BOOST_CHECK_EQUAL(data->response_cache.hits(), 1);
+}
+
+/// the sub requests of a batch are answered in order, a nested batch is refused
+BOOST_AUTO_TEST_CASE(batch_request){
+    ed::builder b("20120614");
+    b.vj("A")("stop_area:stop1", 8*3600 +10*60, 8*3600 + 11 * 60)("stop_area:stop2", 8*3600 + 20 * 60 ,8*3600 + 21*60);
+    b.generate_dummy_basis();
+    b.data->pt_data->index();
+    b.data->build_raptor();
+    b.data->build_uri();
+    b.data->loaded = true;
+
+    DataManager<navitia::type::Data> data_manager;
+    data_manager.publish(std::shared_ptr<navitia::type::Data>(b.data.release()));
+    navitia::Worker w(data_manager);
+
+    pbnavitia::Request request;
+    request.set_requested_api(pbnavitia::BATCH);
+    *request.add_batch() = ptref_request({});
+    auto* place_uri = request.add_batch();
+    place_uri->set_requested_api(pbnavitia::place_uri);
+    place_uri->mutable_place_uri()->set_uri("stop_area:stop1");
+    request.add_batch()->set_requested_api(pbnavitia::BATCH);
+
+    const auto response = w.dispatch(request);
+    BOOST_REQUIRE_EQUAL(response.batch_size(), 3);
+    BOOST_CHECK_EQUAL(response.batch(0).lines_size(), 1);
+    BOOST_REQUIRE_EQUAL(response.batch(1).places_size(), 1);
+    BOOST_CHECK_EQUAL(response.batch(1).places(0).uri(), "stop_area:stop1");
+    BOOST_CHECK_EQUAL(response.batch(2).error().id(), pbnavitia::Error::unknown_api);
+}
+
+/// the departures of every stop, grouped by stop in the order of the request
+BOOST_AUTO_TEST_CASE(next_departures_batch){
+    ed::builder b("20120614");
+    b.vj("A")("stop1", 8000, 8050)("stop2", 8100, 8150);
+    b.vj("A")("stop1", 9000, 9050)("stop2", 9100, 9150);
+    b.vj("B")("stop3", 8500, 8550)("stop1", 8600, 8650);
+    b.generate_dummy_basis();
+    b.data->pt_data->index();
+    b.data->build_raptor();
+    b.data->build_uri();
+    b.data->loaded = true;
+
+    DataManager<navitia::type::Data> data_manager;
+    data_manager.publish(std::shared_ptr<navitia::type::Data>(b.data.release()));
+    navitia::Worker w(data_manager);
+
+    pbnavitia::Request request;
+    request.set_requested_api(pbnavitia::NEXT_DEPARTURES_BATCH);
+    auto* next_departures = request.mutable_next_departures_batch();
+    for(const std::string uri : {"stop1", "stop3", "stop2", "stop_area:unknown"}){
+        next_departures->add_uris(uri);
+    }
+    next_departures->set_from_datetime("20120614T020000");
+    next_departures->set_duration(3 * 3600);
+    next_departures->set_nb_stoptimes(10);
+
+    const auto response = w.dispatch(request);
+    BOOST_REQUIRE_EQUAL(response.stops_next_departures_size(), 4);
+    const auto& stop1 = response.stops_next_departures(0);
+    BOOST_CHECK_EQUAL(stop1.uri(), "stop1");
+    //stop1 is the terminus of B
+    BOOST_REQUIRE_EQUAL(stop1.next_departures_size(), 2);
+    BOOST_CHECK_EQUAL(stop1.next_departures(0).stop_date_time().departure_date_time(), "20120614T021410");
+    BOOST_CHECK_EQUAL(stop1.next_departures(1).stop_date_time().departure_date_time(), "20120614T023050");
+    BOOST_REQUIRE_EQUAL(response.stops_next_departures(1).next_departures_size(), 1);
+    BOOST_CHECK_EQUAL(response.stops_next_departures(1).next_departures(0).vehicle_journey().route().line().uri(), "B");
+    BOOST_CHECK_EQUAL(response.stops_next_departures(2).next_departures_size(), 0);
+    BOOST_CHECK(!response.stops_next_departures(2).has_error());
+    BOOST_CHECK_EQUAL(response.stops_next_departures(3).error().id(), pbnavitia::Error::bad_filter);
+
+    //a date out of the production is an error of the whole request
+    next_departures->set_from_datetime("20100614T020000");
+    BOOST_CHECK_EQUAL(w.dispatch(request).error().id(), pbnavitia::Error::date_out_of_bounds);
+}
@@ -43,6 +43,7 @@ www.navitia.io
 #include "calendar/calendar_api.h"
 #include "routing/raptor.h"
 #include "type/meta_data.h"
+#include <algorithm>
 
 namespace nt = navitia::type;
 namespace pt = boost::posix_time;
@@ -91,9 +92,34 @@ std::vector<std::string> vector_of_admins(const T & admin){
     return result;
 }
 
-Worker::Worker(DataManager<navitia::type::Data>& data_manager) :
+WorkerState::WorkerState(const navitia::type::Data& data) :
+    data(&data),
+    planner(new routing::RAPTOR(data)),
+    street_network(new georef::StreetNetwork(*data.geo_ref)){}
+
+WorkerState::~WorkerState(){}
+
+void WorkerStatePool::reset(std::vector<std::unique_ptr<WorkerState>>&& new_states){
+    std::lock_guard<std::mutex> lock(mutex);
+    states = std::move(new_states);
+}
+
+std::unique_ptr<WorkerState> WorkerStatePool::take(const navitia::type::Data& data){
+    std::lock_guard<std::mutex> lock(mutex);
+    if(states.empty() || states.back()->data != &data){
+        return nullptr;
+    }
+    auto result = std::move(states.back());
+    states.pop_back();
+    return result;
+}
+
+Worker::Worker(DataManager<navitia::type::Data>& data_manager, WorkerStatePool* pool) :
     data_manager(data_manager),
-    logger(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("logger"))){}
+    reader(nullptr),
+    pool(pool),
+    logger(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("logger"))),
+    data(nullptr), data_epoch(0), planner_epoch(0){}
 
 Worker::~Worker(){}
 
@@ -101,20 +127,19 @@ pbnavitia::Response Worker::status() {
     pbnavitia::Response result;
 
     auto status = result.mutable_status();
-    const auto d = data_manager.get_data();
-    status->set_publication_date(pt::to_iso_string(d->meta->publication_date));
-    status->set_start_production_date(bg::to_iso_string(d->meta->production_date.begin()));
-    status->set_end_production_date(bg::to_iso_string(d->meta->production_date.end()));
-    status->set_data_version(d->version);
-    status->set_navimake_version(d->meta->navimake_version);
+    status->set_publication_date(pt::to_iso_string(data->meta->publication_date));
+    status->set_start_production_date(bg::to_iso_string(data->meta->production_date.begin()));
+    status->set_end_production_date(bg::to_iso_string(data->meta->production_date.end()));
+    status->set_data_version(data->version);
+    status->set_navimake_version(data->meta->navimake_version);
     status->set_navitia_version(KRAKEN_VERSION);
-    status->set_loaded(d->loaded);
-    status->set_last_load_status(d->last_load);
-    status->set_last_load_at(pt::to_iso_string(d->last_load_at));
+    status->set_loaded(data->loaded);
+    status->set_last_load_status(data->last_load);
+    status->set_last_load_at(pt::to_iso_string(data->last_load_at));
     Configuration* conf = Configuration::get();
     status->set_nb_threads(conf->get_as<int>("GENERAL", "nb_threads", 1));
-    status->set_is_connected_to_rabbitmq(d->is_connected_to_rabbitmq);
-    for(auto data_sources: d->meta->data_sources){
+    status->set_is_connected_to_rabbitmq(data->is_connected_to_rabbitmq);
+    for(auto data_sources: data->meta->data_sources){
         status->add_data_sources(data_sources);
     }
     return result;
@@ -123,38 +148,44 @@ pbnavitia::Response Worker::status() {
 pbnavitia::Response Worker::metadatas() {
     pbnavitia::Response result;
     auto metadatas = result.mutable_metadatas();
-    const auto d = data_manager.get_data();
-    metadatas->set_start_production_date(bg::to_iso_string(d->meta->production_date.begin()));
-    metadatas->set_end_production_date(bg::to_iso_string(d->meta->production_date.end()));
-    metadatas->set_shape(d->meta->shape);
+    metadatas->set_start_production_date(bg::to_iso_string(data->meta->production_date.begin()));
+    metadatas->set_end_production_date(bg::to_iso_string(data->meta->production_date.end()));
+    metadatas->set_shape(data->meta->shape);
     metadatas->set_status("running");
-    for(const type::Contributor* contributor : d->pt_data->contributors){
+    for(const type::Contributor* contributor : data->pt_data->contributors){
         metadatas->add_contributors(contributor->uri);
     }
     return result;
 }
 
-void Worker::init_worker_data(const std::shared_ptr<navitia::type::Data> data){
+void Worker::init_worker_data(){
     //@TODO should be done in data_manager
-    if(data->last_load_at != this->last_load_at || !planner){
-        planner = std::unique_ptr<routing::RAPTOR>(new routing::RAPTOR(*data));
-        street_network_worker = std::unique_ptr<georef::StreetNetwork>(new georef::StreetNetwork(*data->geo_ref));
-        this->last_load_at = data->last_load_at;
-
-        LOG4CPLUS_INFO(logger, "instanciation du planner");
+    if(this->data_epoch != this->planner_epoch || !state){
+        // the old state is freed before a new one is built
+        state = nullptr;
+        if(pool){
+            state = pool->take(*data);
+        }
+        if(state){
+            LOG4CPLUS_INFO(logger, "planner préparé par le maintenance worker");
+        }else{
+            state = std::unique_ptr<WorkerState>(new WorkerState(*data));
+            LOG4CPLUS_INFO(logger, "instanciation du planner");
+        }
+        this->planner_epoch = this->data_epoch;
     }
+    state->planner->deadline = this->deadline;
+    state->street_network->set_deadline(this->deadline);
 }
 
 
 pbnavitia::Response Worker::autocomplete(const pbnavitia::PlacesRequest & request) {
-    const auto data = data_manager.get_data();
     return navitia::autocomplete::autocomplete(request.q(),
             vector_of_pb_types(request), request.depth(), request.count(),
             vector_of_admins(request), request.search_type(), *data);
 }
 
 pbnavitia::Response Worker::disruptions(const pbnavitia::DisruptionsRequest &request){
-    const auto data = data_manager.get_data();
     std::vector<std::string> forbidden_uris;
     for(int i = 0; i < request.forbidden_uris_size(); ++i)
         forbidden_uris.push_back(request.forbidden_uris(i));
@@ -169,7 +200,6 @@ pbnavitia::Response Worker::disruptions(const pbnavitia::DisruptionsRequest &req
 }
 
 pbnavitia::Response Worker::calendars(const pbnavitia::CalendarsRequest &request){
-    const auto data = data_manager.get_data();
     std::vector<std::string> forbidden_uris;
     for(int i = 0; i < request.forbidden_uris_size(); ++i)
         forbidden_uris.push_back(request.forbidden_uris(i));
@@ -185,12 +215,11 @@ pbnavitia::Response Worker::calendars(const pbnavitia::CalendarsRequest &request
 
 pbnavitia::Response Worker::next_stop_times(const pbnavitia::NextStopTimeRequest &request,
         pbnavitia::API api) {
-    const auto data = data_manager.get_data();
     int32_t max_date_times = request.has_max_date_times() ? request.max_date_times() : std::numeric_limits<int>::max();
     std::vector<std::string> forbidden_uri;
     for(int i = 0; i < request.forbidden_uri_size(); ++i)
         forbidden_uri.push_back(request.forbidden_uri(i));
-    this->init_worker_data(data);
+    this->init_worker_data();
     try {
         switch(api) {
         case pbnavitia::NEXT_DEPARTURES:
@@ -242,10 +271,17 @@ pbnavitia::Response Worker::next_stop_times(const pbnavitia::NextStopTimeRequest
 }
 
 
+pbnavitia::Response Worker::next_departures_batch(const pbnavitia::NextDeparturesBatchRequest &request) {
+    const std::vector<std::string> uris(request.uris().begin(), request.uris().end());
+    return timetables::next_departures_batch(uris, request.from_datetime(),
+            request.duration(), request.nb_stoptimes(), request.depth(),
+            type::AccessibiliteParams(), *data, false, request.show_codes());
+}
+
+
 pbnavitia::Response Worker::proximity_list(const pbnavitia::PlacesNearbyRequest &request) {
-    const auto data = data_manager.get_data();
     type::EntryPoint ep(data->get_type_of_id(request.uri()), request.uri());
-    auto coord = this->coord_of_entry_point(ep, data);
+    auto coord = this->coord_of_entry_point(ep, *data);
     return proximitylist::find(coord, request.distance(), vector_of_pb_types(request),
                 request.filter(), request.depth(), request.count(),
                 request.start_page(), *data);
@@ -254,37 +290,37 @@ pbnavitia::Response Worker::proximity_list(const pbnavitia::PlacesNearbyRequest
 
 type::GeographicalCoord Worker::coord_of_entry_point(
         const type::EntryPoint & entry_point,
-        const std::shared_ptr<navitia::type::Data> data) {
+        const navitia::type::Data& data) {
     type::GeographicalCoord result;
     if(entry_point.type == Type_e::Address){
-        auto way = data->geo_ref->way_map.find(entry_point.uri);
-        if (way != data->geo_ref->way_map.end()){
-            const auto geo_way = data->geo_ref->ways[way->second];
-            result = geo_way->nearest_coord(entry_point.house_number, data->geo_ref->graph);
+        auto way = data.geo_ref->way_map.find(entry_point.uri);
+        if (way != data.geo_ref->way_map.end()){
+            const auto geo_way = data.geo_ref->ways[way->second];
+            result = geo_way->nearest_coord(entry_point.house_number, data.geo_ref->graph);
         }
     } else if (entry_point.type == Type_e::StopPoint) {
-        auto sp_it = data->pt_data->stop_points_map.find(entry_point.uri);
-        if(sp_it != data->pt_data->stop_points_map.end()) {
+        auto sp_it = data.pt_data->stop_points_map.find(entry_point.uri);
+        if(sp_it != data.pt_data->stop_points_map.end()) {
             result = sp_it->second->coord;
         }
     } else if (entry_point.type == Type_e::StopArea) {
-           auto sa_it = data->pt_data->stop_areas_map.find(entry_point.uri);
-           if(sa_it != data->pt_data->stop_areas_map.end()) {
+           auto sa_it = data.pt_data->stop_areas_map.find(entry_point.uri);
+           if(sa_it != data.pt_data->stop_areas_map.end()) {
                result = sa_it->second->coord;
            }
     } else if (entry_point.type == Type_e::Coord) {
         result = entry_point.coordinates;
     } else if (entry_point.type == Type_e::Admin) {
-        auto it_admin = data->geo_ref->admin_map.find(entry_point.uri);
-        if (it_admin != data->geo_ref->admin_map.end()) {
-            const auto admin = data->geo_ref->admins[it_admin->second];
+        auto it_admin = data.geo_ref->admin_map.find(entry_point.uri);
+        if (it_admin != data.geo_ref->admin_map.end()) {
+            const auto admin = data.geo_ref->admins[it_admin->second];
             result = admin->coord;
         }
 
     } else if(entry_point.type == Type_e::POI){
-        auto poi = data->geo_ref->poi_map.find(entry_point.uri);
-        if (poi != data->geo_ref->poi_map.end()){
-            const auto geo_poi = data->geo_ref->pois[poi->second];
+        auto poi = data.geo_ref->poi_map.find(entry_point.uri);
+        if (poi != data.geo_ref->poi_map.end()){
+            const auto geo_poi = data.geo_ref->pois[poi->second];
             result = geo_poi->coord;
         }
     }
@@ -293,7 +329,7 @@ type::GeographicalCoord Worker::coord_of_entry_point(
 
 
 type::StreetNetworkParams Worker::streetnetwork_params_of_entry_point(const pbnavitia::StreetNetworkParams & request,
-        const std::shared_ptr<navitia::type::Data> data,
+        const navitia::type::Data& data,
         const bool use_second){
     type::StreetNetworkParams result;
     std::string uri;
@@ -307,19 +343,19 @@ type::StreetNetworkParams Worker::streetnetwork_params_of_entry_point(const pbna
     }
     switch(result.mode){
         case type::Mode_e::Bike:
-            result.offset = data->geo_ref->offsets[type::Mode_e::Bike];
+            result.offset = data.geo_ref->offsets[type::Mode_e::Bike];
             result.speed_factor = request.bike_speed() / georef::default_speed[type::Mode_e::Bike];
             break;
         case type::Mode_e::Car:
-            result.offset = data->geo_ref->offsets[type::Mode_e::Car];
+            result.offset = data.geo_ref->offsets[type::Mode_e::Car];
             result.speed_factor = request.car_speed() / georef::default_speed[type::Mode_e::Car];
             break;
         case type::Mode_e::Bss:
-            result.offset = data->geo_ref->offsets[type::Mode_e::Bss];
+            result.offset = data.geo_ref->offsets[type::Mode_e::Bss];
             result.speed_factor = request.bss_speed() / georef::default_speed[type::Mode_e::Bss];
             break;
         default:
-            result.offset = data->geo_ref->offsets[type::Mode_e::Walking];
+            result.offset = data.geo_ref->offsets[type::Mode_e::Walking];
             result.speed_factor = request.walking_speed() / georef::default_speed[type::Mode_e::Walking];
             break;
     }
@@ -330,13 +366,12 @@ type::StreetNetworkParams Worker::streetnetwork_params_of_entry_point(const pbna
 
 
 pbnavitia::Response Worker::place_uri(const pbnavitia::PlaceUriRequest &request) {
-    const auto data = data_manager.get_data();
-    this->init_worker_data(data);
+    this->init_worker_data();
     pbnavitia::Response pb_response;
 
     if(request.uri().size() > 6 && request.uri().substr(0, 6) == "coord:") {
         type::EntryPoint ep(type::Type_e::Coord, request.uri());
-        auto coord = this->coord_of_entry_point(ep, data);
+        auto coord = this->coord_of_entry_point(ep, *data);
         auto tmp = proximitylist::find(coord, 100, {type::Type_e::Address}, "", 1, 1, 0, *data);
         if(tmp.places_nearby().size() == 1){
             auto place = pb_response.add_places();
@@ -387,8 +422,7 @@ pbnavitia::Response Worker::place_uri(const pbnavitia::PlaceUriRequest &request)
 }
 
 pbnavitia::Response Worker::journeys(const pbnavitia::JourneysRequest &request, pbnavitia::API api) {
-    const auto data = data_manager.get_data();
-    this->init_worker_data(data);
+    this->init_worker_data();
 
     Type_e origin_type = data->get_type_of_id(request.origin());
     type::EntryPoint origin = type::EntryPoint(origin_type, request.origin());
@@ -396,7 +430,7 @@ pbnavitia::Response Worker::journeys(const pbnavitia::JourneysRequest &request,
     if (origin.type == type::Type_e::Address || origin.type == type::Type_e::Admin
             || origin.type == type::Type_e::StopArea || origin.type == type::Type_e::StopPoint
             || origin.type == type::Type_e::POI) {
-        origin.coordinates = this->coord_of_entry_point(origin, data);
+        origin.coordinates = this->coord_of_entry_point(origin, *data);
     }
 
     type::EntryPoint destination;
@@ -406,7 +440,7 @@ pbnavitia::Response Worker::journeys(const pbnavitia::JourneysRequest &request,
         if (destination.type == type::Type_e::Address || destination.type == type::Type_e::Admin
                 || destination.type == type::Type_e::StopArea || destination.type == type::Type_e::StopPoint
                 || destination.type == type::Type_e::POI) {
-            destination.coordinates = this->coord_of_entry_point(destination, data);
+            destination.coordinates = this->coord_of_entry_point(destination, *data);
         }
     }
 
@@ -421,27 +455,27 @@ pbnavitia::Response Worker::journeys(const pbnavitia::JourneysRequest &request,
     /// Récupération des paramètres de rabattement au départ
     if ((origin.type == type::Type_e::Address) || (origin.type == type::Type_e::Coord)
             || (origin.type == type::Type_e::Admin) || (origin.type == type::Type_e::POI) || (origin.type == type::Type_e::StopArea)){
-        origin.streetnetwork_params = this->streetnetwork_params_of_entry_point(request.streetnetwork_params(), data);
+        origin.streetnetwork_params = this->streetnetwork_params_of_entry_point(request.streetnetwork_params(), *data);
     }
     /// Récupération des paramètres de rabattement à l'arrivée
     if ((destination.type == type::Type_e::Address) || (destination.type == type::Type_e::Coord)
             || (destination.type == type::Type_e::Admin) || (destination.type == type::Type_e::POI) || (destination.type == type::Type_e::StopArea)){
-        destination.streetnetwork_params = this->streetnetwork_params_of_entry_point(request.streetnetwork_params(), data, false);
+        destination.streetnetwork_params = this->streetnetwork_params_of_entry_point(request.streetnetwork_params(), *data, false);
     }
 /// Accessibilité, il faut initialiser ce paramètre
     //HOT FIX degueulasse
     type::AccessibiliteParams accessibilite_params;
     accessibilite_params.properties.set(type::hasProperties::WHEELCHAIR_BOARDING, request.wheelchair());
     if(api != pbnavitia::ISOCHRONE){
-        return routing::make_response(*planner, origin, destination, datetimes,
+        return routing::make_response(*state->planner, origin, destination, datetimes,
                 request.clockwise(), accessibilite_params,
-                forbidden, *street_network_worker,
+                forbidden, *state->street_network,
                 request.disruption_active(), request.max_duration(),
                 request.max_transfers(), request.show_codes());
     } else {
-        return navitia::routing::make_isochrone(*planner, origin, request.datetimes(0),
+        return navitia::routing::make_isochrone(*state->planner, origin, request.datetimes(0),
                 request.clockwise(), accessibilite_params,
-                forbidden, *street_network_worker,
+                forbidden, *state->street_network,
                 request.disruption_active(), request.max_duration(),
                 request.max_transfers(), request.show_codes());
     }
@@ -449,7 +483,6 @@ pbnavitia::Response Worker::journeys(const pbnavitia::JourneysRequest &request,
 
 
 pbnavitia::Response Worker::pt_ref(const pbnavitia::PTRefRequest &request){
-    const auto data = data_manager.get_data();
     std::vector<std::string> forbidden_uri;
     for(int i = 0; i < request.forbidden_uri_size(); ++i)
         forbidden_uri.push_back(request.forbidden_uri(i));
@@ -461,34 +494,178 @@ pbnavitia::Response Worker::pt_ref(const pbnavitia::PTRefRequest &request){
 }
 
 
-pbnavitia::Response Worker::dispatch(const pbnavitia::Request& request) {
-    pbnavitia::Response result ;
-    if (! data_manager.get_data()->loaded){
-        fill_pb_error(pbnavitia::Error::service_unavailable, "The service is loading data", result.mutable_error());
-        return result;
+bool is_cacheable(pbnavitia::API api) {
+    switch(api){
+        case pbnavitia::PTREFERENTIAL:
+        case pbnavitia::calendars:
+        case pbnavitia::ROUTE_SCHEDULES:
+        case pbnavitia::DEPARTURE_BOARDS:
+        case pbnavitia::place_uri:
+            return true;
+        default:
+            return false;
     }
+}
+
+template<typename Uris>
+static void sort_uris(Uris* uris) {
+    std::sort(uris->begin(), uris->end());
+}
+
+std::string response_cache_key(const pbnavitia::Request& request) {
+    pbnavitia::Request canonical;
+    canonical.set_requested_api(request.requested_api());
     switch(request.requested_api()){
-        case pbnavitia::STATUS: return status(); break;
-        case pbnavitia::places: return autocomplete(request.places()); break;
-        case pbnavitia::place_uri: return place_uri(request.place_uri()); break;
+        case pbnavitia::PTREFERENTIAL:
+            *canonical.mutable_ptref() = request.ptref();
+            sort_uris(canonical.mutable_ptref()->mutable_forbidden_uri());
+            break;
+        case pbnavitia::calendars:
+            *canonical.mutable_calendars() = request.calendars();
+            sort_uris(canonical.mutable_calendars()->mutable_forbidden_uris());
+            break;
         case pbnavitia::ROUTE_SCHEDULES:
-        case pbnavitia::NEXT_DEPARTURES:
-        case pbnavitia::NEXT_ARRIVALS:
-        case pbnavitia::STOPS_SCHEDULES:
         case pbnavitia::DEPARTURE_BOARDS:
-            return next_stop_times(request.next_stop_times(), request.requested_api()); break;
-        case pbnavitia::ISOCHRONE:
-        case pbnavitia::PLANNER: return journeys(request.journeys(), request.requested_api()); break;
-        case pbnavitia::places_nearby: return proximity_list(request.places_nearby()); break;
-        case pbnavitia::PTREFERENTIAL: return pt_ref(request.ptref()); break;
-        case pbnavitia::METADATAS : return metadatas(); break;
-        case pbnavitia::disruptions : return disruptions(request.disruptions()); break;
-        case pbnavitia::calendars : return calendars(request.calendars()); break;
+            *canonical.mutable_next_stop_times() = request.next_stop_times();
+            sort_uris(canonical.mutable_next_stop_times()->mutable_forbidden_uri());
+            break;
+        case pbnavitia::place_uri:
+            *canonical.mutable_place_uri() = request.place_uri();
+            break;
         default:
-            LOG4CPLUS_WARN(logger, "Unknown API : " + API_Name(request.requested_api()));
-            fill_pb_error(pbnavitia::Error::unknown_api, "Unknown API", result.mutable_error());
             break;
     }
+    return canonical.SerializePartialAsString();
+}
+
+
+DataManager<navitia::type::Data>::Pin Worker::pin_data(const pbnavitia::Request& request) {
+    if(! reader){
+        reader = &data_manager.register_reader();
+    }
+    // the generation is pinned for the whole request, a reload can't free it
+    auto pin = data_manager.pin(*reader);
+    this->data = pin.get();
+    this->data_epoch = pin.epoch();
+    this->deadline = pt::not_a_date_time;
+    if(request.has_deadline()){
+        this->deadline = pt::from_time_t(request.deadline() / 1000)
+                + pt::milliseconds(request.deadline() % 1000);
+    }
+    return pin;
+}
+
+pbnavitia::Response Worker::dispatch(const pbnavitia::Request& request) {
+    const auto pin = this->pin_data(request);
+    auto result = this->handle(request);
+    this->data = nullptr;
+    return result;
+}
+
+std::shared_ptr<const std::string> Worker::dispatch_serialized(const pbnavitia::Request& request) {
+    const auto pin = this->pin_data(request);
+    auto payload = this->serialized_handle(request);
+    this->data = nullptr;
+    return payload;
+}
+
+std::shared_ptr<const std::string> Worker::serialized_handle(const pbnavitia::Request& request) {
+    // the realtime data can change without a new generation,
+    // and the published messages change with the time
+    const std::string key = std::to_string(data->realtime_version()) + ":"
+        + std::to_string(data->message_window(pt::second_clock::local_time())) + ":"
+        + response_cache_key(request);
+    if(auto cached = data->response_cache.get(key)){
+        return cached;
+    }
+    const auto result = this->handle(request);
+    auto payload = std::make_shared<std::string>();
+    result.SerializeToString(payload.get());
+    // these errors depend on the load of kraken, not on the request
+    const bool transient = result.has_error()
+        && (result.error().id() == pbnavitia::Error::deadline_exceeded
+            || result.error().id() == pbnavitia::Error::service_unavailable);
+    if(! transient){
+        data->response_cache.insert(key, payload, key.size() + payload->size());
+    }
+    return payload;
+}
+
+std::unique_ptr<WorkerState> Worker::warm_up(navitia::type::Data& data,
+        const std::vector<pbnavitia::Request>& requests) {
+    this->data = &data;
+    this->deadline = pt::not_a_date_time;
+    this->state = std::unique_ptr<WorkerState>(new WorkerState(data));
+    this->planner_epoch = this->data_epoch;
+    for(const pbnavitia::Request& request : requests){
+        try{
+            this->handle(request);
+        }catch(const std::exception& e){
+            LOG4CPLUS_WARN(logger, "warm up request failed: " << e.what());
+        }
+    }
+    this->data = nullptr;
+    return std::move(this->state);
+}
+
+pbnavitia::Response Worker::batch(const pbnavitia::Request& request) {
+    pbnavitia::Response result;
+    for(const pbnavitia::Request& sub_request : request.batch()){
+        pbnavitia::Response* sub_response = result.add_batch();
+        if(sub_request.requested_api() == pbnavitia::BATCH){
+            fill_pb_error(pbnavitia::Error::unknown_api, "A batch can't contain a batch",
+                    sub_response->mutable_error());
+        }else if(is_cacheable(sub_request.requested_api())){
+            sub_response->ParseFromString(*this->serialized_handle(sub_request));
+        }else{
+            this->handle(sub_request).Swap(sub_response);
+        }
+    }
+    return result;
+}
+
+pbnavitia::Response Worker::handle(const pbnavitia::Request& request) {
+    pbnavitia::Response result ;
+    if (! data->loaded){
+        fill_pb_error(pbnavitia::Error::service_unavailable, "The service is loading data", result.mutable_error());
+        return result;
+    }
+    if(deadline_passed(deadline)){
+        LOG4CPLUS_INFO(logger, "deadline exceeded before the request was processed");
+        fill_pb_error(pbnavitia::Error::deadline_exceeded, "Deadline exceeded", result.mutable_error());
+        return result;
+    }
+    try{
+        switch(request.requested_api()){
+            case pbnavitia::STATUS: return status(); break;
+            case pbnavitia::places: return autocomplete(request.places()); break;
+            case pbnavitia::place_uri: return place_uri(request.place_uri()); break;
+            case pbnavitia::ROUTE_SCHEDULES:
+            case pbnavitia::NEXT_DEPARTURES:
+            case pbnavitia::NEXT_ARRIVALS:
+            case pbnavitia::STOPS_SCHEDULES:
+            case pbnavitia::DEPARTURE_BOARDS:
+                return next_stop_times(request.next_stop_times(), request.requested_api()); break;
+            case pbnavitia::NEXT_DEPARTURES_BATCH:
+                return next_departures_batch(request.next_departures_batch()); break;
+            case pbnavitia::ISOCHRONE:
+            case pbnavitia::PLANNER: return journeys(request.journeys(), request.requested_api()); break;
+            case pbnavitia::places_nearby: return proximity_list(request.places_nearby()); break;
+            case pbnavitia::PTREFERENTIAL: return pt_ref(request.ptref()); break;
+            case pbnavitia::METADATAS : return metadatas(); break;
+            case pbnavitia::disruptions : return disruptions(request.disruptions()); break;
+            case pbnavitia::calendars : return calendars(request.calendars()); break;
+            case pbnavitia::BATCH : return batch(request); break;
+            default:
+                LOG4CPLUS_WARN(logger, "Unknown API : " + API_Name(request.requested_api()));
+                fill_pb_error(pbnavitia::Error::unknown_api, "Unknown API", result.mutable_error());
+                break;
+        }
+    }catch(const navitia::DeadlineExceeded&){
+        LOG4CPLUS_INFO(logger, "deadline exceeded during the computation");
+        result.Clear();
+        fill_pb_error(pbnavitia::Error::deadline_exceeded, "Deadline exceeded", result.mutable_error());
+    }
 
     return result;
 }
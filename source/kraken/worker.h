@@ -45,44 +45,115 @@ namespace routing{
 #include "utils/logger.h"
 
 #include <memory>
+#include <mutex>
+#include <vector>
 
 namespace navitia {
 
+/// search state of a worker, built for one generation of the data
+struct WorkerState {
+    const navitia::type::Data* data;
+    std::unique_ptr<navitia::routing::RAPTOR> planner;
+    std::unique_ptr<navitia::georef::StreetNetwork> street_network;
+
+    WorkerState(const navitia::type::Data& data);
+    ~WorkerState();
+};
+
+/**
+ * Search states built by the maintenance worker before the publication of a
+ * generation, the workers take them instead of building their own at the
+ * first request on this generation
+ */
+class WorkerStatePool {
+    private:
+        std::mutex mutex;
+        std::vector<std::unique_ptr<WorkerState>> states;
+
+    public:
+        /// replace the states of the previous generation
+        void reset(std::vector<std::unique_ptr<WorkerState>>&& new_states);
+        /// a state built on data, nullptr if there is none left
+        std::unique_ptr<WorkerState> take(const navitia::type::Data& data);
+};
+
+/// the response of these apis depends only on the request and the data
+bool is_cacheable(pbnavitia::API api);
+
+/**
+ * Key of the request in the response cache: the request without the fields
+ * not changing the response (deadline, other apis), with the forbidden uris sorted
+ */
+std::string response_cache_key(const pbnavitia::Request& request);
+
 class Worker {
     private:
-        std::unique_ptr<navitia::routing::RAPTOR> planner;
-        std::unique_ptr<navitia::georef::StreetNetwork> street_network_worker;
+        std::unique_ptr<WorkerState> state;
 
         // we keep a reference to data_manager in each thread
         DataManager<navitia::type::Data>& data_manager;
+        // registered at the first request, a worker used for the warm up has none
+        DataManager<navitia::type::Data>::Reader* reader;
+        WorkerStatePool* pool;
 
         log4cplus::Logger logger;
-        boost::posix_time::ptime last_load_at;
+        // generation pinned by dispatch for the current request
+        navitia::type::Data* data;
+        uint64_t data_epoch;
+        // generation the planner and the street network are built on
+        uint64_t planner_epoch;
+        // UTC deadline of the current request, not_a_date_time if there is none
+        boost::posix_time::ptime deadline;
+
+        pbnavitia::Response handle(const pbnavitia::Request & request);
+        /// pin the current generation for the request
+        DataManager<navitia::type::Data>::Pin pin_data(const pbnavitia::Request & request);
+        /// serialized response, through the response cache of the pinned generation if the api is cacheable
+        std::shared_ptr<const std::string> serialized_handle(const pbnavitia::Request & request);
 
     public:
-        Worker(DataManager<navitia::type::Data>& data_manager);
+        Worker(DataManager<navitia::type::Data>& data_manager, WorkerStatePool* pool = nullptr);
         //we override de destructor this way we can forward declare Raptor
         //see: https://stackoverflow.com/questions/6012157/is-stdunique-ptrt-required-to-know-the-full-definition-of-t
         ~Worker();
 
         pbnavitia::Response dispatch(const pbnavitia::Request & request);
 
+        /**
+         * Serialized response of a cacheable api, served by the response cache
+         * of the pinned generation when the same request has already been answered
+         */
+        std::shared_ptr<const std::string> dispatch_serialized(const pbnavitia::Request & request);
+
+        /**
+         * Build a search state on a data not published yet and replay the
+         * requests on it, so the first requests after a reload are not slower
+         */
+        std::unique_ptr<WorkerState> warm_up(navitia::type::Data& data,
+                const std::vector<pbnavitia::Request>& requests);
+
         type::GeographicalCoord coord_of_entry_point(const type::EntryPoint & entry_point,
-                const std::shared_ptr<navitia::type::Data> data);
-        type::StreetNetworkParams streetnetwork_params_of_entry_point(const pbnavitia::StreetNetworkParams & request, const std::shared_ptr<navitia::type::Data> data, const bool use_second = true);
+                const navitia::type::Data& data);
+        type::StreetNetworkParams streetnetwork_params_of_entry_point(const pbnavitia::StreetNetworkParams & request, const navitia::type::Data& data, const bool use_second = true);
+
+        void init_worker_data();
 
-        void init_worker_data(const std::shared_ptr<navitia::type::Data> data);
+        // the api methods work on the generation pinned by dispatch
 
         pbnavitia::Response status();
         pbnavitia::Response metadatas();
         pbnavitia::Response autocomplete(const pbnavitia::PlacesRequest &request);
         pbnavitia::Response place_uri(const pbnavitia::PlaceUriRequest &request);
         pbnavitia::Response next_stop_times(const pbnavitia::NextStopTimeRequest &request, pbnavitia::API api);
+        /// next departures of many stops, grouped by stop
+        pbnavitia::Response next_departures_batch(const pbnavitia::NextDeparturesBatchRequest &request);
         pbnavitia::Response proximity_list(const pbnavitia::PlacesNearbyRequest &request);
         pbnavitia::Response journeys(const pbnavitia::JourneysRequest &request, pbnavitia::API api);
         pbnavitia::Response pt_ref(const pbnavitia::PTRefRequest &request);
         pbnavitia::Response disruptions(const pbnavitia::DisruptionsRequest &request);
         pbnavitia::Response calendars(const pbnavitia::CalendarsRequest &request);
+        /// the sub requests of a batch, all on the generation pinned by dispatch
+        pbnavitia::Response batch(const pbnavitia::Request &request);
 };
 
 }
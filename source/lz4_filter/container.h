@@ -0,0 +1,387 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+#include "third_party/lz4/lz4.h"
+#include "type/parallel.h"
+#include <boost/iostreams/concepts.hpp>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <future>
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <boost/cstdint.hpp>
+
+/**
+ * Conteneur de sections compressées en LZ4
+ *
+ * Chaque section est découpée en chunks compressés indépendamment, un index à la fin du fichier
+ * donne la position et la taille de chaque chunk. Une section peut donc être lue seule,
+ * et ses chunks décompressés en parallèle par plusieurs threads.
+ *
+ * Format :
+ *   magic | chunks... | index | position de l'index (uint64) | magic
+ *   index : nombre de sections (uint32), puis pour chaque section :
+ *           taille du nom (uint32), nom, empreinte (uint64), nombre de chunks (uint64),
+ *           puis pour chaque chunk : position (uint64), taille compressée (uint32), taille décompressée (uint32)
+ */
+namespace lz4_container {
+
+const char magic[8] = {'N', 'A', 'V', 'L', 'Z', '4', 'C', '1'};
+
+struct Chunk {
+    uint64_t offset;
+    uint32_t compressed_size;
+    uint32_t raw_size;
+};
+
+inline size_t default_nb_threads() {
+    return navitia::hardware_nb_threads();
+}
+
+/// FNV-1a, pour les empreintes des sections
+const uint64_t fnv_offset = 14695981039346656037ULL;
+const uint64_t fnv_prime = 1099511628211ULL;
+
+inline uint64_t fnv_hash(const std::string& bytes, uint64_t hash = fnv_offset) {
+    for(const char c : bytes) {
+        hash = (hash ^ uint8_t(c)) * fnv_prime;
+    }
+    return hash;
+}
+
+}
+
+/**
+ * Écriture d'un conteneur
+ *
+ * Les chunks d'une section sont compressés en parallèle par paquets de nb_threads
+ */
+class LZ4ContainerWriter {
+public:
+    /// Sink boost::iostreams écrivant dans la section courante
+    class Sink : public boost::iostreams::sink {
+        LZ4ContainerWriter* writer;
+    public:
+        explicit Sink(LZ4ContainerWriter* writer) : writer(writer) {}
+        std::streamsize write(const char* s, std::streamsize n) {
+            writer->write(s, n);
+            return n;
+        }
+    };
+
+    LZ4ContainerWriter(const std::string& filename, size_t chunk_size = 4*1024*1024,
+                       size_t nb_threads = lz4_container::default_nb_threads()) :
+        out(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc),
+        chunk_size(chunk_size), nb_threads(std::max<size_t>(1, nb_threads)) {
+        if(!out) {
+            throw std::runtime_error("unable to open " + filename);
+        }
+        out.write(lz4_container::magic, sizeof(lz4_container::magic));
+    }
+
+    ~LZ4ContainerWriter() {
+        if(!closed) {
+            try { close(); } catch(...) {}
+        }
+    }
+
+    void begin_section(const std::string& name) {
+        if(!current_section.empty()) {
+            end_section();
+        }
+        current_section = name;
+        sections[name].clear();
+        fingerprints[name] = lz4_container::fnv_offset;
+        order.push_back(name);
+    }
+
+    Sink sink() { return Sink(this); }
+
+    void end_section() {
+        if(!buffer.empty()) {
+            pending.push_back(std::move(buffer));
+            buffer.clear();
+        }
+        compress_pending();
+        current_section.clear();
+    }
+
+    /// Écrit l'index, le fichier n'est valide qu'après l'appel
+    void close() {
+        if(!current_section.empty()) {
+            end_section();
+        }
+        const uint64_t index_offset = out.tellp();
+        write_value(uint32_t(order.size()));
+        for(const std::string& name : order) {
+            const auto& chunks = sections[name];
+            write_value(uint32_t(name.size()));
+            out.write(name.data(), name.size());
+            write_value(fingerprints[name]);
+            write_value(uint64_t(chunks.size()));
+            for(const auto& chunk : chunks) {
+                write_value(chunk.offset);
+                write_value(chunk.compressed_size);
+                write_value(chunk.raw_size);
+            }
+        }
+        write_value(index_offset);
+        out.write(lz4_container::magic, sizeof(lz4_container::magic));
+        out.close();
+        closed = true;
+        if(!out) {
+            throw std::runtime_error("unable to write the lz4 container");
+        }
+    }
+
+private:
+    std::ofstream out;
+    size_t chunk_size;
+    size_t nb_threads;
+    bool closed = false;
+    std::string current_section;
+    std::vector<std::string> order;
+    std::map<std::string, std::vector<lz4_container::Chunk>> sections;
+    std::map<std::string, uint64_t> fingerprints;
+    std::string buffer;
+    std::vector<std::string> pending;
+
+    template<typename T>
+    void write_value(T value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void write(const char* s, std::streamsize n) {
+        if(current_section.empty()) {
+            throw std::runtime_error("no lz4 container section to write in");
+        }
+        while(n > 0) {
+            const size_t size = std::min<size_t>(n, chunk_size - buffer.size());
+            buffer.append(s, size);
+            s += size;
+            n -= size;
+            if(buffer.size() == chunk_size) {
+                pending.push_back(std::move(buffer));
+                buffer.clear();
+                if(pending.size() >= nb_threads) {
+                    compress_pending();
+                }
+            }
+        }
+    }
+
+    /// Compresse les chunks en attente, chacun hashé par le thread qui le compresse
+    void compress_pending() {
+        std::vector<std::future<std::pair<std::string, uint64_t>>> compressed;
+        for(const std::string& raw : pending) {
+            compressed.push_back(std::async(std::launch::async, [&raw]() {
+                std::string result(LZ4_compressBound(raw.size()), '\0');
+                const int size = LZ4_compress(raw.data(), &result[0], raw.size());
+                if(size <= 0) {
+                    throw std::runtime_error("lz4 compression failed");
+                }
+                result.resize(size);
+                const uint64_t hash = lz4_container::fnv_hash(result);
+                return std::make_pair(std::move(result), hash);
+            }));
+        }
+        uint64_t& fingerprint = fingerprints[current_section];
+        for(size_t i = 0; i < pending.size(); ++i) {
+            const auto chunk = compressed[i].get();
+            sections[current_section].push_back({uint64_t(out.tellp()), uint32_t(chunk.first.size()),
+                                                 uint32_t(pending[i].size())});
+            out.write(chunk.first.data(), chunk.first.size());
+            fingerprint = (fingerprint ^ chunk.second) * lz4_container::fnv_prime;
+            fingerprint = (fingerprint ^ pending[i].size()) * lz4_container::fnv_prime;
+        }
+        pending.clear();
+    }
+};
+
+/**
+ * Lecture d'un conteneur
+ *
+ * Une section est lue via une Source boost::iostreams qui décompresse en avance
+ * les chunks suivants sur plusieurs threads, pendant que l'appelant consomme le chunk courant
+ */
+class LZ4ContainerReader {
+    struct SectionState {
+        std::shared_ptr<std::ifstream> in;
+        std::vector<lz4_container::Chunk> chunks;
+        size_t next_chunk = 0;
+        size_t window = 1;
+        std::deque<std::future<std::string>> decompressing;
+        std::string current;
+        size_t position = 0;
+
+        void schedule() {
+            while(decompressing.size() < window && next_chunk < chunks.size()) {
+                const lz4_container::Chunk chunk = chunks[next_chunk++];
+                auto compressed = std::make_shared<std::string>(chunk.compressed_size, '\0');
+                in->seekg(chunk.offset);
+                in->read(&(*compressed)[0], chunk.compressed_size);
+                if(!*in) {
+                    throw std::runtime_error("truncated lz4 container");
+                }
+                decompressing.push_back(std::async(std::launch::async, [compressed, chunk]() {
+                    std::string raw(chunk.raw_size, '\0');
+                    const int size = LZ4_uncompress_unknownOutputSize(compressed->data(), &raw[0],
+                                                                      chunk.compressed_size, chunk.raw_size);
+                    if(size < 0 || uint32_t(size) != chunk.raw_size) {
+                        throw std::runtime_error("corrupted lz4 chunk");
+                    }
+                    return raw;
+                }));
+            }
+        }
+    };
+
+public:
+    /// Source boost::iostreams d'une section
+    class Source : public boost::iostreams::source {
+        std::shared_ptr<SectionState> state;
+    public:
+        explicit Source(const std::shared_ptr<SectionState>& state) : state(state) {}
+        std::streamsize read(char* s, std::streamsize n) {
+            std::streamsize result = 0;
+            while(n > 0) {
+                if(state->position == state->current.size()) {
+                    if(state->decompressing.empty()) {
+                        break;
+                    }
+                    state->current = state->decompressing.front().get();
+                    state->decompressing.pop_front();
+                    state->position = 0;
+                    state->schedule();
+                    continue;
+                }
+                const size_t size = std::min<size_t>(n, state->current.size() - state->position);
+                std::memcpy(s, state->current.data() + state->position, size);
+                state->position += size;
+                s += size;
+                n -= size;
+                result += size;
+            }
+            return result == 0 ? -1 : result;
+        }
+    };
+
+    /// Est-ce que le fichier est un conteneur (sinon c'est l'ancien format séquentiel)
+    static bool is_container(const std::string& filename) {
+        std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+        char buffer[sizeof(lz4_container::magic)];
+        in.read(buffer, sizeof(buffer));
+        return in && std::memcmp(buffer, lz4_container::magic, sizeof(buffer)) == 0;
+    }
+
+    explicit LZ4ContainerReader(const std::string& filename) : filename(filename) {
+        std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+        const auto footer_size = sizeof(uint64_t) + sizeof(lz4_container::magic);
+        in.seekg(0, std::ios::end);
+        const uint64_t file_size = in.tellg();
+        if(!in || file_size < sizeof(lz4_container::magic) + footer_size) {
+            throw std::runtime_error("invalid lz4 container " + filename);
+        }
+        in.seekg(file_size - footer_size);
+        const uint64_t index_offset = read_value<uint64_t>(in);
+        char buffer[sizeof(lz4_container::magic)];
+        in.read(buffer, sizeof(buffer));
+        if(!in || std::memcmp(buffer, lz4_container::magic, sizeof(buffer)) != 0 || index_offset > file_size) {
+            throw std::runtime_error("invalid lz4 container " + filename);
+        }
+        in.seekg(index_offset);
+        const uint32_t nb_sections = read_value<uint32_t>(in);
+        for(uint32_t i = 0; i < nb_sections && in; ++i) {
+            std::string name(read_value<uint32_t>(in), '\0');
+            in.read(&name[0], name.size());
+            fingerprints[name] = read_value<uint64_t>(in);
+            auto& chunks = sections[name];
+            chunks.resize(read_value<uint64_t>(in));
+            for(auto& chunk : chunks) {
+                chunk.offset = read_value<uint64_t>(in);
+                chunk.compressed_size = read_value<uint32_t>(in);
+                chunk.raw_size = read_value<uint32_t>(in);
+            }
+        }
+        if(!in) {
+            throw std::runtime_error("invalid lz4 container index " + filename);
+        }
+    }
+
+    bool has_section(const std::string& name) const {
+        return sections.find(name) != sections.end();
+    }
+
+    /// Source de la section, avec au plus nb_threads chunks décompressés en avance
+    Source section(const std::string& name, size_t nb_threads = lz4_container::default_nb_threads()) const {
+        auto it = sections.find(name);
+        if(it == sections.end()) {
+            throw std::runtime_error("no section " + name + " in " + filename);
+        }
+        auto state = std::make_shared<SectionState>();
+        state->in = std::make_shared<std::ifstream>(filename.c_str(), std::ios::in | std::ios::binary);
+        state->chunks = it->second;
+        state->window = std::max<size_t>(1, nb_threads);
+        state->schedule();
+        return Source(state);
+    }
+
+    /**
+     * Empreinte (FNV-1a) des chunks compressés d'une section, calculée à l'écriture et lue dans l'index
+     *
+     * La compression est déterministe : deux sections de même contenu ont la même empreinte,
+     * ce qui permet de savoir si une section a changé sans la lire
+     */
+    uint64_t fingerprint(const std::string& name) const {
+        auto it = fingerprints.find(name);
+        if(it == fingerprints.end()) {
+            throw std::runtime_error("no section " + name + " in " + filename);
+        }
+        return it->second;
+    }
+
+private:
+    std::string filename;
+    std::map<std::string, std::vector<lz4_container::Chunk>> sections;
+    std::map<std::string, uint64_t> fingerprints;
+
+    template<typename T>
+    static T read_value(std::istream& in) {
+        T value = T();
+        in.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return value;
+    }
+};
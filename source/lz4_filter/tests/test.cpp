@@ -29,6 +29,7 @@ www.navitia.io
 */
 
 #include "lz4_filter/filter.h"
+#include "lz4_filter/container.h"
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE test_lz4_filter
 #include <boost/test/unit_test.hpp>
@@ -36,7 +37,9 @@ www.navitia.io
 #include <boost/iostreams/device/file_descriptor.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/stream.hpp>
 #include <string>
+#include <cstdio>
 
 
 BOOST_AUTO_TEST_CASE(tiny_string_compression){
@@ -98,3 +101,84 @@ BOOST_AUTO_TEST_CASE(big_string_compression){
     }
     BOOST_CHECK_EQUAL(str, result);
 }
+
+BOOST_AUTO_TEST_CASE(container_sections){
+    std::string big = "foobariozafiozehfuiozefuigaezgfuzegfpuzheuerfhzeupgf";
+    for (int i = 0; i < 12; i++) {
+        big += big + std::to_string(i);
+    }
+    const std::string small = "foo bar";
+    {
+        //small chunks to have a lot of them
+        LZ4ContainerWriter writer("my_file.lz4c", 1000, 4);
+        writer.begin_section("big");
+        {
+            boost::iostreams::stream<LZ4ContainerWriter::Sink> out(writer.sink());
+            out << big;
+        }
+        writer.begin_section("small");
+        {
+            boost::iostreams::stream<LZ4ContainerWriter::Sink> out(writer.sink());
+            out << small;
+        }
+        writer.begin_section("empty");
+        writer.close();
+    }
+    BOOST_CHECK(LZ4ContainerReader::is_container("my_file.lz4c"));
+    BOOST_CHECK(!LZ4ContainerReader::is_container("my_file.lz4"));
+
+    LZ4ContainerReader reader("my_file.lz4c");
+    BOOST_CHECK(reader.has_section("empty"));
+    BOOST_CHECK(!reader.has_section("other"));
+    BOOST_CHECK_THROW(reader.section("other"), std::runtime_error);
+    //the sections can be read in any order
+    std::string result;
+    {
+        boost::iostreams::stream<LZ4ContainerReader::Source> in(reader.section("small"));
+        std::getline(in, result);
+        BOOST_CHECK_EQUAL(result, small);
+    }
+    for(size_t nb_threads : {1, 3, 8}) {
+        boost::iostreams::stream<LZ4ContainerReader::Source> in(reader.section("big", nb_threads));
+        in >> result;
+        BOOST_CHECK(result == big);
+    }
+    {
+        boost::iostreams::stream<LZ4ContainerReader::Source> in(reader.section("empty"));
+        BOOST_CHECK(!std::getline(in, result));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(container_fingerprint){
+    auto write = [](const std::string& filename, const std::string& first, const std::string& second) {
+        LZ4ContainerWriter writer(filename, 1000, 2);
+        writer.begin_section("first");
+        {
+            boost::iostreams::stream<LZ4ContainerWriter::Sink> out(writer.sink());
+            out << first;
+        }
+        writer.begin_section("second");
+        {
+            boost::iostreams::stream<LZ4ContainerWriter::Sink> out(writer.sink());
+            out << second;
+        }
+        writer.close();
+    };
+    std::string big = "foobariozafiozehfuiozefuigaezgfuzegfpuzheuerfhzeupgf";
+    for (int i = 0; i < 8; i++) {
+        big += big + std::to_string(i);
+    }
+    write("my_file_1.lz4c", "foo bar", big);
+    write("my_file_2.lz4c", "foo baz", big);
+
+    LZ4ContainerReader reader_1("my_file_1.lz4c");
+    LZ4ContainerReader reader_2("my_file_2.lz4c");
+    //the fingerprints are in the index, the sections are not read again
+    std::remove("my_file_1.lz4c");
+    std::remove("my_file_2.lz4c");
+    //the sections with the same content have the same fingerprint, even at another position
+    BOOST_CHECK_EQUAL(reader_1.fingerprint("second"), reader_2.fingerprint("second"));
+    BOOST_CHECK_NE(reader_1.fingerprint("first"), reader_2.fingerprint("first"));
+    BOOST_CHECK_NE(reader_1.fingerprint("first"), reader_1.fingerprint("second"));
+    BOOST_CHECK_THROW(reader_1.fingerprint("other"), std::runtime_error);
+}
@@ -33,6 +33,10 @@ www.navitia.io
 #include "type/type.h"
 #include <vector>
 #include <cmath>
+#include <unordered_map>
+#include <limits>
+#include <algorithm>
+#include <atomic>
 
 namespace navitia { namespace proximitylist {
 
@@ -43,8 +47,9 @@ struct NotFound : public std::exception{};
  *
  * Le template T est le type que l'on souhaite indexer (typiquement un Idx). L'élément sera copié.
  * On rajoute des élements itérativements et on appelle build pour construire l'indexe.
- * L'implémentation est un bête tableau trié par X.
- * On cherche les bornes inf/sup selon X, puis on itère sur les données et on garde les bonnes
+ * Les éléments sont gardés dans un tableau trié par X, et indexés par une grille de cellules
+ * de cell_size degrés : une recherche ne parcourt que les cellules autour du point.
+ * Si le rayon couvre plus de cellules qu'il n'y en a de non vides, on se rabat sur la bande selon X.
  */
 
 template<class T>
@@ -64,38 +69,124 @@ struct ProximityList
     /// Contient toutes les coordonnées de manière à trouver rapidement
     std::vector<Item> items;
 
+    /** Identifiant de l'état de l'index, jamais réutilisé par une autre liste ni un autre contenu
+      *
+      * Il change à chaque construction de l'index, et une copie en prend un nouveau :
+      * il peut servir de clef de cache, contrairement à l'adresse de la liste
+      */
+    struct Generation {
+        uint64_t value = next();
+        Generation() {}
+        Generation(const Generation&) {}
+        Generation& operator=(const Generation&) { value = next(); return *this; }
+        static uint64_t next() {
+            static std::atomic<uint64_t> counter(0);
+            return ++counter;
+        }
+    };
+    Generation generation;
+
+    /// Taille des cellules de la grille (en degrés)
+    static constexpr double cell_size = 0.005;
+
     /// Rajoute un nouvel élément. Attention, il faut appeler build avant de pouvoir utiliser la structure
     void add(GeographicalCoord coord, T element){
         items.push_back(Item(coord,element));
     }
     void clear(){
         items.clear();
+        build_grid();
     }
 
     /// Construit l'indexe
     void build(){
         std::sort(items.begin(), items.end(), [](const Item & a, const Item & b){return a.coord < b.coord;});
+        build_grid();
     }
 
     /// Retourne tous les éléments dans un rayon de x mètres
     std::vector< std::pair<T, GeographicalCoord> > find_within(GeographicalCoord coord, double distance = 500) const {
         double distance_degree = distance / 111320;
 
-        double DEG_TO_RAD = 0.0174532925199432958;
         double coslat = ::cos(coord.lat() * DEG_TO_RAD);
-
-        auto begin = std::lower_bound(items.begin(), items.end(), coord.lon() - distance_degree / coslat, [](const Item & i, double min){return i.coord.lon() < min;});
-        auto end = std::upper_bound(begin, items.end(), coord.lon() + distance_degree / coslat, [](double max, const Item & i){return max < i.coord.lon();});
-        std::vector< std::pair<T, GeographicalCoord> > result;
         double max_dist = distance * distance;
-        for(; begin != end; ++begin){
-            if(begin->coord.approx_sqr_distance(coord, coslat) <= max_dist)
-                result.push_back(std::make_pair(begin->element, begin->coord));
+        std::vector< std::pair<T, GeographicalCoord> > result;
+        auto keep_if_within = [&](const Item& item){
+            if(item.coord.approx_sqr_distance(coord, coslat) <= max_dist)
+                result.push_back(std::make_pair(item.element, item.coord));
+        };
+
+        const int min_x = cell(coord.lon() - distance_degree / coslat), max_x = cell(coord.lon() + distance_degree / coslat);
+        const int min_y = cell(coord.lat() - distance_degree), max_y = cell(coord.lat() + distance_degree);
+        const double nb_cells = double(max_x - min_x + 1) * double(max_y - min_y + 1);
+        if(nb_cells <= cells.size()){
+            for(int x = min_x; x <= max_x; ++x){
+                for(int y = min_y; y <= max_y; ++y){
+                    for_each_in_cell(x, y, keep_if_within);
+                }
+            }
+        } else {
+            auto begin = std::lower_bound(items.begin(), items.end(), coord.lon() - distance_degree / coslat, [](const Item & i, double min){return i.coord.lon() < min;});
+            auto end = std::upper_bound(begin, items.end(), coord.lon() + distance_degree / coslat, [](double max, const Item & i){return max < i.coord.lon();});
+            std::for_each(begin, end, keep_if_within);
         }
         std::sort(result.begin(), result.end(), [&coord, &coslat](const std::pair<T, GeographicalCoord> & a, const std::pair<T, GeographicalCoord> & b){return a.second.approx_sqr_distance(coord, coslat) < b.second.approx_sqr_distance(coord, coslat);});
         return result;
     }
 
+    /** Retourne les k éléments les plus proches dans un rayon de max_dist mètres, triés par distance
+      *
+      * On parcourt les cellules par anneaux autour du point, et on s'arrête dès que
+      * les k meilleurs éléments sont plus proches que le bord de la zone parcourue
+      */
+    std::vector< std::pair<T, GeographicalCoord> > find_k_nearest(GeographicalCoord coord, size_t k, double max_dist = 500) const {
+        std::vector< std::pair<T, GeographicalCoord> > result;
+        if(k == 0 || cells.empty())
+            return result;
+
+        double coslat = ::cos(coord.lat() * DEG_TO_RAD);
+        double max_sqr_dist = max_dist * max_dist;
+        //smallest width of a cell, a ring of cells is at least this far from the previous ring
+        double cell_width = cell_size * 111320 * std::min(1., coslat);
+        typedef std::pair<double, const Item*> candidate;
+        std::vector<candidate> candidates;
+        auto keep_if_within = [&](const Item& item){
+            double dist = item.coord.approx_sqr_distance(coord, coslat);
+            if(dist <= max_sqr_dist)
+                candidates.push_back(candidate(dist, &item));
+        };
+
+        const int center_x = cell(coord.lon()), center_y = cell(coord.lat());
+        //beyond this ring, there is no more item
+        const int last_ring = std::max(std::max(std::abs(center_x - grid_min_x), std::abs(grid_max_x - center_x)),
+                                       std::max(std::abs(center_y - grid_min_y), std::abs(grid_max_y - center_y)));
+        for(int ring = 0; ring <= last_ring; ++ring){
+            for(int x = center_x - ring; x <= center_x + ring; ++x){
+                if(std::abs(x - center_x) == ring){
+                    for(int y = center_y - ring; y <= center_y + ring; ++y)
+                        for_each_in_cell(x, y, keep_if_within);
+                } else {
+                    for_each_in_cell(x, center_y - ring, keep_if_within);
+                    for_each_in_cell(x, center_y + ring, keep_if_within);
+                }
+            }
+            double covered_dist = ring * cell_width;
+            if(candidates.size() >= k){
+                std::nth_element(candidates.begin(), candidates.begin() + k - 1, candidates.end(),
+                                 [](const candidate& a, const candidate& b){return a.first < b.first;});
+                if(candidates[k - 1].first <= covered_dist * covered_dist)
+                    break;
+            }
+            if(covered_dist > max_dist)
+                break;
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [](const candidate& a, const candidate& b){return a.first < b.first;});
+        for(size_t i = 0; i < candidates.size() && i < k; ++i){
+            result.push_back(std::make_pair(candidates[i].second->element, candidates[i].second->coord));
+        }
+        return result;
+    }
 
     /// Fonction de confort pour retrouver l'élément le plus proche dans l'indexe
     T find_nearest(double lon, double lat) const {
@@ -104,7 +195,7 @@ struct ProximityList
 
     /// Retourne l'élément le plus proche dans tout l'indexe
     T find_nearest(GeographicalCoord coord, double max_dist = 500) const {
-        auto temp = find_within(coord, max_dist);
+        auto temp = find_k_nearest(coord, 1, max_dist);
         if(temp.empty())
             throw NotFound();
         else
@@ -118,8 +209,66 @@ struct ProximityList
       */
     template<class Archive> void serialize(Archive & ar, const unsigned int) {
         ar & items;
+        //the grid is not serialized, we build it back
+        if(Archive::is_loading::value)
+            build_grid();
+    }
+
+private:
+    static constexpr double DEG_TO_RAD = 0.0174532925199432958;
+
+    /// index of the items (in items) ordered by cell
+    std::vector<uint32_t> grid_items;
+    /// range in grid_items of each non empty cell
+    std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> cells;
+    /// bounds of the non empty cells
+    int grid_min_x = 0, grid_max_x = 0, grid_min_y = 0, grid_max_y = 0;
+
+    static int cell(double degree) {
+        return static_cast<int>(std::floor(degree / cell_size));
     }
 
+    static uint64_t cell_key(int x, int y) {
+        return (uint64_t(uint32_t(x)) << 32) | uint32_t(y);
+    }
+
+    template<typename F>
+    void for_each_in_cell(int x, int y, F f) const {
+        auto it = cells.find(cell_key(x, y));
+        if(it == cells.end())
+            return;
+        for(uint32_t i = it->second.first; i < it->second.second; ++i)
+            f(items[grid_items[i]]);
+    }
+
+    void build_grid(){
+        generation = Generation();
+        grid_items.resize(items.size());
+        for(uint32_t i = 0; i < items.size(); ++i)
+            grid_items[i] = i;
+        auto key = [&](uint32_t i){return cell_key(cell(items[i].coord.lon()), cell(items[i].coord.lat()));};
+        std::stable_sort(grid_items.begin(), grid_items.end(), [&](uint32_t a, uint32_t b){return key(a) < key(b);});
+
+        cells.clear();
+        grid_min_x = grid_min_y = std::numeric_limits<int>::max();
+        grid_max_x = grid_max_y = std::numeric_limits<int>::min();
+        for(uint32_t begin = 0; begin < grid_items.size();){
+            const uint64_t current = key(grid_items[begin]);
+            uint32_t end = begin;
+            while(end < grid_items.size() && key(grid_items[end]) == current)
+                ++end;
+            cells[current] = std::make_pair(begin, end);
+            const auto& c = items[grid_items[begin]].coord;
+            grid_min_x = std::min(grid_min_x, cell(c.lon()));
+            grid_max_x = std::max(grid_max_x, cell(c.lon()));
+            grid_min_y = std::min(grid_min_y, cell(c.lat()));
+            grid_max_y = std::max(grid_max_y, cell(c.lat()));
+            begin = end;
+        }
+    }
 };
 
+template<class T> constexpr double ProximityList<T>::cell_size;
+template<class T> constexpr double ProximityList<T>::DEG_TO_RAD;
+
 }} // namespace navitia::proximitylist
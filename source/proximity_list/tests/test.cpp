@@ -169,6 +169,47 @@ BOOST_AUTO_TEST_CASE(find_nearest){
     BOOST_CHECK_EQUAL_COLLECTIONS(tmp.begin(), tmp.end(), expected.begin(), expected.end());
 }
 
+BOOST_AUTO_TEST_CASE(find_with_grid){
+    //the grid must give the same results as a scan of all the items
+    ProximityList<unsigned int> pl;
+    std::vector<GeographicalCoord> coords;
+    srand(42);
+    for(unsigned int i = 0; i < 2000; ++i){
+        GeographicalCoord c(2.3 + 0.2 * rand() / RAND_MAX, 48.8 + 0.1 * rand() / RAND_MAX);
+        pl.add(c, i);
+        coords.push_back(c);
+    }
+    pl.build();
+
+    GeographicalCoord center(2.35, 48.85);
+    double coslat = ::cos(center.lat() * 0.0174532925199432958);
+    for(double distance : {10., 300., 1000., 50000.}){
+        std::vector<unsigned int> expected;
+        for(unsigned int i = 0; i < coords.size(); ++i){
+            if(coords[i].approx_sqr_distance(center, coslat) <= distance * distance)
+                expected.push_back(i);
+        }
+        std::vector<unsigned int> found;
+        for(auto p : pl.find_within(center, distance)) found.push_back(p.first);
+        std::sort(found.begin(), found.end());
+        BOOST_CHECK_EQUAL_COLLECTIONS(found.begin(), found.end(), expected.begin(), expected.end());
+    }
+
+    std::vector<unsigned int> sorted(coords.size());
+    for(unsigned int i = 0; i < coords.size(); ++i) sorted[i] = i;
+    std::sort(sorted.begin(), sorted.end(), [&](unsigned int a, unsigned int b){
+        return coords[a].approx_sqr_distance(center, coslat) < coords[b].approx_sqr_distance(center, coslat);});
+    auto nearest = pl.find_k_nearest(center, 10, 100000);
+    BOOST_REQUIRE_EQUAL(nearest.size(), 10);
+    for(size_t i = 0; i < nearest.size(); ++i)
+        BOOST_CHECK_EQUAL(nearest[i].first, sorted[i]);
+    BOOST_CHECK_EQUAL(pl.find_nearest(center), sorted[0]);
+
+    //the max distance is respected
+    BOOST_CHECK(pl.find_k_nearest(GeographicalCoord(3, 48.85), 10, 500).empty());
+    BOOST_CHECK_THROW(pl.find_nearest(GeographicalCoord(3, 48.85)), NotFound);
+}
+
 BOOST_AUTO_TEST_CASE(test_api) {
     navitia::type::Data data;
     //Everything in the range
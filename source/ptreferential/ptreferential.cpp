@@ -34,6 +34,7 @@ www.navitia.io
 #include "proximity_list/proximity_list.h"
 #include "georef/pois.h"
 #include "type/data.h"
+#include "type/lru_cache.h"
 
 #include <algorithm>
 #include <regex>
@@ -117,11 +118,42 @@ std::vector<idx_t> filtered_indexes(const std::vector<T> & data, const C & claus
     return result;
 }
 
+/** Objet d'uri donnée retrouvé par la map des uris, sans parcourir toute la collection
+  *
+  * Retourne false si la map n'est pas utilisable (type sans map, map pas construite ou uris en double) :
+  * il faut alors évaluer le filtre sur la collection
+  */
+template<typename T>
+bool find_by_uri(const Data &, const std::string &, std::vector<idx_t> &) {
+    return false;
+}
+
+#define FIND_BY_URI(type_name, collection_name)\
+template<>\
+bool find_by_uri<type_name>(const Data & d, const std::string & uri, std::vector<idx_t> & indexes) {\
+    const auto & collection = d.pt_data->collection_name;\
+    const auto & map = d.pt_data->collection_name##_map;\
+    if(map.size() != collection.size()) {\
+        return false;\
+    }\
+    auto it = map.find(uri);\
+    if(it == map.end()) {\
+        return true;\
+    }\
+    if(it->second->idx >= collection.size() || collection[it->second->idx] != it->second) {\
+        return false;\
+    }\
+    indexes.push_back(it->second->idx);\
+    return true;\
+}
+ITERATE_NAVITIA_PT_TYPES(FIND_BY_URI)
+
 template<typename T>
 std::vector<idx_t> get_indexes(Filter filter,  Type_e requested_type, const Data & d) {
-    auto data = d.get_data<T>();
     std::vector<idx_t> indexes;
-    if(filter.op == DWITHIN) {
+    if(filter.op == EQ && filter.attribute == "uri" && find_by_uri<T>(d, filter.value, indexes)) {
+        // objet trouvé par la map des uris, les objets demandés par les relations ci-dessous
+    } else if(filter.op == DWITHIN) {
         std::vector<std::string> splited;
         boost::algorithm::split(splited, filter.value, boost::algorithm::is_any_of(","));
         GeographicalCoord coord;
@@ -166,7 +198,7 @@ std::vector<idx_t> get_indexes(Filter filter,  Type_e requested_type, const Data
         }
     }
     else {
-        indexes = filtered_indexes(data, build_clause<T>({filter}));
+        indexes = filtered_indexes(d.get_data<T>(), build_clause<T>({filter}));
     }
     Type_e current = filter.navitia_type;
     std::map<Type_e, Type_e> path = find_path(requested_type);
@@ -193,15 +225,21 @@ std::vector<Filter> parse(std::string request){
     return filters;
 }
 
-std::vector<idx_t> make_query(Type_e requested_type, std::string request,
-                              const std::vector<std::string>& forbidden_uris,
-                              const Data & data) {
-    std::vector<Filter> filters;
-
-    if(!request.empty()){
-        filters = parse(request);
+/** Filtres analysés et typés de la requête
+  *
+  * L'analyse ne dépend pas des données, les filtres sont donc gardés en cache
+  * pour toutes les générations de données : les mêmes filtres reviennent sans cesse (stop_area.uri=X)
+  */
+static std::vector<Filter> parse_filters(const std::string & request) {
+    static LruCache<std::string, std::vector<Filter>> parsed_filters(10000);
+    if(request.empty()){
+        return {};
+    }
+    if(auto filters = parsed_filters.get(request)){
+        return *filters;
     }
 
+    std::vector<Filter> filters = parse(request);
     type::static_data * static_data = type::static_data::get();
     for(Filter & filter : filters){
         try {
@@ -211,14 +249,29 @@ std::vector<idx_t> make_query(Type_e requested_type, std::string request,
                     "Filter Unknown object type: " + filter.object);
         }
     }
-    std::vector<idx_t> final_indexes = data.get_all_index(requested_type);
-    // Cas où on a aucun objet demandé dans la base (au pif, des companies…)
-    if(final_indexes.empty()){
-        throw ptref_error("Filters: No requested object in the database");
-        return final_indexes;
+    parsed_filters.insert(request, std::make_shared<const std::vector<Filter>>(filters));
+    return filters;
+}
+
+std::vector<idx_t> make_query(Type_e requested_type, std::string request,
+                              const std::vector<std::string>& forbidden_uris,
+                              const Data & data) {
+    const std::vector<Filter> filters = parse_filters(request);
+    type::static_data * static_data = type::static_data::get();
+
+    // Sans filtre on part de tous les objets, sinon du résultat du premier filtre :
+    // inutile de construire la liste de tous les objets pour un stop_area.uri=X
+    std::vector<idx_t> final_indexes;
+    if(filters.empty()){
+        final_indexes = data.get_all_index(requested_type);
+        // Cas où on a aucun objet demandé dans la base (au pif, des companies…)
+        if(final_indexes.empty()){
+            throw ptref_error("Filters: No requested object in the database");
+        }
     }
 
     std::vector<idx_t> indexes;
+    bool first_filter = true;
     for(const Filter & filter : filters){
         switch(filter.navitia_type){
 #define GET_INDEXES(type_name, collection_name) case Type_e::type_name: indexes = get_indexes<type_name>(filter, requested_type, data); break;
@@ -233,12 +286,20 @@ std::vector<idx_t> make_query(Type_e requested_type, std::string request,
         }
         // Attention ! les structures doivent être triées !
         std::sort(indexes.begin(), indexes.end());
-        std::unique(indexes.begin(), indexes.end());
+        indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+        if(first_filter){
+            final_indexes = std::move(indexes);
+            first_filter = false;
+            continue;
+        }
         std::vector<idx_t> tmp_indexes;
         std::back_insert_iterator< std::vector<idx_t> > it(tmp_indexes);
         std::set_intersection(final_indexes.begin(), final_indexes.end(), indexes.begin(), indexes.end(), it);
         final_indexes = tmp_indexes;
     }
+    if(final_indexes.empty() && data.nb_elements(requested_type) == 0){
+        throw ptref_error("Filters: No requested object in the database");
+    }
     //We now filter with forbidden uris
     for(const auto forbidden_uri : forbidden_uris) {
         const auto type_ = data.get_type_of_id(forbidden_uri);
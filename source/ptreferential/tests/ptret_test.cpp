@@ -260,6 +260,32 @@ BOOST_AUTO_TEST_CASE(make_query_filtre_direct) {
     BOOST_CHECK_EQUAL(indexes.size(), 1);
 }
 
+/// the uri filters are answered by the uri maps, and by a scan of the collection when a map can't be used
+BOOST_AUTO_TEST_CASE(make_query_uri_map) {
+    ed::builder b("201303011T1739");
+    b.generate_dummy_basis();
+    b.vj("A")("stop1", 8000,8050)("stop2", 8200,8250);
+    b.vj("B")("stop3", 9000,9050)("stop1", 9200,9250);
+    b.data->pt_data->index();
+    b.data->pt_data->build_uri();
+
+    auto indexes = make_query(navitia::type::Type_e::JourneyPatternPoint, "stop_area.uri=stop1", *(b.data));
+    BOOST_REQUIRE_EQUAL(indexes.size(), 2);
+    for(auto idx : indexes) {
+        BOOST_CHECK_EQUAL(b.data->pt_data->journey_pattern_points[idx]->stop_point->uri, "stop1");
+    }
+    //the parsed filter comes from the cache the second time
+    BOOST_CHECK(make_query(navitia::type::Type_e::JourneyPatternPoint, "stop_area.uri=stop1", *(b.data)) == indexes);
+    BOOST_CHECK_THROW(make_query(navitia::type::Type_e::JourneyPatternPoint, "stop_area.uri=unknown", *(b.data)), ptref_error);
+
+    //two stop points with the same uri: the map only has one of them
+    b.data->pt_data->stop_points_map.at("stop2")->uri = "stop1";
+    b.data->pt_data->stop_points_map.clear();
+    b.data->pt_data->build_uri();
+    indexes = make_query(navitia::type::Type_e::StopPoint, "stop_point.uri=stop1", *(b.data));
+    BOOST_CHECK_EQUAL(indexes.size(), 2);
+}
+
 BOOST_AUTO_TEST_CASE(forbidden_uri) {
 
     ed::builder b("201303011T1739");
@@ -36,11 +36,12 @@ std::pair<const type::StopTime*, uint32_t>
 best_stop_time(const type::JourneyPatternPoint* jpp,
                const DateTime dt,
                const type::VehicleProperties& vehicle_properties,
-               const bool clockwise, bool disruption_active, const type::Data &data, bool reconstructing_path) {
+               const bool clockwise, bool disruption_active, const type::Data &data, bool reconstructing_path,
+               const type::RealtimeOverlay* overlay) {
     if(clockwise)
-        return earliest_stop_time(jpp, dt, data, disruption_active, reconstructing_path, {}, vehicle_properties);
+        return earliest_stop_time(jpp, dt, data, disruption_active, reconstructing_path, {}, vehicle_properties, overlay);
     else
-        return tardiest_stop_time(jpp, dt, data, disruption_active, reconstructing_path, vehicle_properties);
+        return tardiest_stop_time(jpp, dt, data, disruption_active, reconstructing_path, vehicle_properties, overlay);
 }
 
 /** Which is the first valid stop_time in this range ?
@@ -49,7 +50,7 @@ best_stop_time(const type::JourneyPatternPoint* jpp,
 const type::StopTime* next_valid_pick_up(type::idx_t idx, const type::idx_t end, const DateTime dt,
         const type::Data &data, bool reconstructing_path,
         const type::VehicleProperties &required_vehicle_properties,
-        bool disruption_active){
+        bool disruption_active, const type::RealtimeOverlay* overlay){
     const auto date = DateTimeUtils::date(dt);
     const auto hour = DateTimeUtils::hour(dt);
     for(; idx < end; ++idx) {
@@ -57,6 +58,11 @@ const type::StopTime* next_valid_pick_up(type::idx_t idx, const type::idx_t end,
         if (st->valid_end(reconstructing_path) && st->valid_hour(hour, true) &&
             ((disruption_active && st->arrival_adapted_validity_pattern->check(date)) || ((!disruption_active) && st->arrival_validity_pattern->check(date)))
             && st->vehicle_journey->accessible(required_vehicle_properties) ){
+                // course supprimée ou arrêt non desservi en temps réel
+                const type::TripUpdate* update = type::trip_update(overlay, st, date, true);
+                if(update != nullptr && update->skips(st->journey_pattern_point->order)) {
+                    continue;
+                }
                 return st;
         }
     }
@@ -71,12 +77,12 @@ const type::StopTime* next_valid_pick_up(type::idx_t idx, const type::idx_t end,
  * - with a calendar and a hour => we look for the next valid stop time valid for the calendar and after the hour of the date time.
  */
 std::pair<const type::StopTime*, DateTime>
-valid_pick_up(const std::vector<uint32_t>::const_iterator begin, type::idx_t idx, const type::idx_t end, const DateTime dt,
+valid_pick_up(const uint32_t* begin, type::idx_t idx, const type::idx_t end, const DateTime dt,
         const type::Data &data, bool reconstructing_path,
         const type::VehicleProperties &vehicle_properties,
-        bool disruption_active) {
+        bool disruption_active, const type::RealtimeOverlay* overlay) {
     const type::StopTime* first_st = next_valid_pick_up(idx, end,
-            dt, data, reconstructing_path, vehicle_properties, disruption_active);
+            dt, data, reconstructing_path, vehicle_properties, disruption_active, overlay);
     // If no trip was found, we look for one the day after
     if(first_st != nullptr) {
         return {first_st, dt};
@@ -84,7 +90,7 @@ valid_pick_up(const std::vector<uint32_t>::const_iterator begin, type::idx_t idx
     idx = begin - data.dataRaptor->departure_times.begin();
     auto working_dt = DateTimeUtils::set(DateTimeUtils::date(dt)+1, 0);
     first_st = next_valid_pick_up(idx, end, working_dt,
-        data, reconstructing_path, vehicle_properties,disruption_active);
+        data, reconstructing_path, vehicle_properties,disruption_active, overlay);
 
     return {first_st, working_dt};
 }
@@ -115,7 +121,7 @@ const type::StopTime* valid_pick_up(type::idx_t idx, const type::idx_t end, cons
 const type::StopTime* valid_drop_off(type::idx_t idx, const type::idx_t end, const DateTime dt,
                const type::Data &data, bool reconstructing_path,
                const type::VehicleProperties &required_vehicle_properties,
-               bool disruption_active){
+               bool disruption_active, const type::RealtimeOverlay* overlay){
     const auto date = DateTimeUtils::date(dt);
     const auto hour = DateTimeUtils::hour(dt);
     for(; idx < end; ++idx) {
@@ -123,6 +129,10 @@ const type::StopTime* valid_drop_off(type::idx_t idx, const type::idx_t end, con
         if (st->valid_end(!reconstructing_path) && st->valid_hour(hour, false) &&
             ((disruption_active && st->arrival_adapted_validity_pattern->check(date)) || ((!disruption_active) && st->arrival_validity_pattern->check(date)))
             && st->vehicle_journey->accessible(required_vehicle_properties) ){
+                const type::TripUpdate* update = type::trip_update(overlay, st, date, false);
+                if(update != nullptr && update->skips(st->journey_pattern_point->order)) {
+                    continue;
+                }
                 return st;
         }
     }
@@ -136,7 +146,8 @@ earliest_stop_time(const type::JourneyPatternPoint* jpp,
                    bool disruption_active,
                    bool reconstructing_path,
                    boost::optional<const std::string> calendar_id,
-                   const type::VehicleProperties& vehicle_properties) {
+                   const type::VehicleProperties& vehicle_properties,
+                   const type::RealtimeOverlay* overlay) {
     //On cherche le plus petit stop time de la journey_pattern >= dt.hour()
     auto begin = data.dataRaptor->departure_times.begin() +
             data.dataRaptor->first_stop_time[jpp->journey_pattern->idx] +
@@ -152,7 +163,7 @@ earliest_stop_time(const type::JourneyPatternPoint* jpp,
     //On renvoie le premier trip valide
     std::pair<const type::StopTime*, DateTime> first_st = {nullptr, 0};
     if (! calendar_id) {
-        first_st = valid_pick_up(begin, idx, end_idx, dt, data, reconstructing_path, vehicle_properties, disruption_active);
+        first_st = valid_pick_up(begin, idx, end_idx, dt, data, reconstructing_path, vehicle_properties, disruption_active, overlay);
     } else {
         first_st.first = valid_pick_up(idx, end_idx, DateTimeUtils::hour(dt), *calendar_id, data, reconstructing_path, vehicle_properties);
         first_st.second = dt;
@@ -176,7 +187,8 @@ std::pair<const type::StopTime*, uint32_t>
 tardiest_stop_time(const type::JourneyPatternPoint* jpp,
                    const DateTime dt, const type::Data &data, bool disruption_active,
                    bool reconstructing_path,
-                   const type::VehicleProperties& vehicle_properties) {
+                   const type::VehicleProperties& vehicle_properties,
+                   const type::RealtimeOverlay* overlay) {
     //On cherche le plus grand stop time de la journey_pattern <= dt.hour()
     const auto begin = data.dataRaptor->arrival_times.begin() +
                        data.dataRaptor->first_stop_time[jpp->journey_pattern->idx] +
@@ -190,7 +202,7 @@ tardiest_stop_time(const type::JourneyPatternPoint* jpp,
 
     const type::StopTime* first_st = valid_drop_off(idx, end_idx,
             dt, data,
-            reconstructing_path, vehicle_properties, disruption_active);
+            reconstructing_path, vehicle_properties, disruption_active, overlay);
 
     auto working_dt = dt;
     // If no trip was found, we look for one the day before
@@ -199,7 +211,7 @@ tardiest_stop_time(const type::JourneyPatternPoint* jpp,
         working_dt = DateTimeUtils::set(DateTimeUtils::date(working_dt) - 1,
                                         DateTimeUtils::SECONDS_PER_DAY - 1);
         first_st = valid_drop_off(idx, end_idx, working_dt, data, reconstructing_path,
-                vehicle_properties, disruption_active);
+                vehicle_properties, disruption_active, overlay);
     }
 
     if(first_st != nullptr){
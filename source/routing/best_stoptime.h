@@ -37,18 +37,21 @@ www.navitia.io
 namespace navitia { namespace routing {
 ///Cherche le premier stop_time partant apres dt sur la journey_pattern au journey_pattern point order
 ///. Renvoie le stop time et la première heure de départ après dt
+/// Les courses supprimées ou ne desservant pas l'arrêt dans overlay sont ignorées
 std::pair<const type::StopTime*, uint32_t>
 earliest_stop_time(const type::JourneyPatternPoint* jpp,
               const DateTime dt,
               const type::Data &data, bool disruption_active, bool reconstructing_path,
               boost::optional<const std::string> calendar_id = {},
-              const type::VehicleProperties & vehicle_properties = type::VehicleProperties());
+              const type::VehicleProperties & vehicle_properties = type::VehicleProperties(),
+              const type::RealtimeOverlay* overlay = nullptr);
 ///Cherche le premier stop_time partant avant dt sur la journey_pattern au journey_pattern point order
 /// Renvoie la première heure d'arrivée avant dt
 std::pair<const type::StopTime*, uint32_t>
 tardiest_stop_time(const type::JourneyPatternPoint* jpp,
               const DateTime dt, const type::Data &data, bool disruption_active, bool reconstructing_path,
-              const type::VehicleProperties & vehicle_properties = type::VehicleProperties());
+              const type::VehicleProperties & vehicle_properties = type::VehicleProperties(),
+              const type::RealtimeOverlay* overlay = nullptr);
 
 /// Returns the next stop time at given journey pattern point
 /// either a vehicle that leaves or that arrives depending on clockwise
@@ -57,7 +60,8 @@ best_stop_time(const type::JourneyPatternPoint* jpp,
           const DateTime dt,
           /*const type::Properties &required_properties*/
           const type::VehicleProperties & vehicle_properties,
-          const bool clockwise, bool disruption_active, const type::Data &data, bool reconstructing_path = false);
+          const bool clockwise, bool disruption_active, const type::Data &data, bool reconstructing_path = false,
+          const type::RealtimeOverlay* overlay = nullptr);
 
 /// Pour les horaires en frequences
 
@@ -31,10 +31,11 @@ www.navitia.io
 #include "dataraptor.h"
 #include "routing.h"
 #include "routing/raptor_utils.h"
+#include "utils/exception.h"
 
 namespace navitia { namespace routing {
 
-void dataRAPTOR::load(const type::PT_Data &data)
+void dataRAPTOR::load(const type::PT_Data &data, const std::shared_ptr<const type::MappedFlatFile>& flat_file)
 {
     Label label;
     label.dt = DateTimeUtils::inf;
@@ -44,16 +45,8 @@ void dataRAPTOR::load(const type::PT_Data &data)
     label.dt = DateTimeUtils::min;
     labels_const_reverse.assign(data.journey_pattern_points.size(), label);
     
-    foot_path_forward.clear();
-    foot_path_backward.clear();
-    footpath_index_backward.clear();
-    footpath_index_forward.clear();
     footpath_rp_backward.clear();
     footpath_rp_forward.clear();
-    std::vector<std::map<navitia::type::idx_t, const navitia::type::StopPointConnection*> > footpath_temp_forward, footpath_temp_backward;
-    footpath_temp_forward.resize(data.stop_points.size());
-    footpath_temp_backward.resize(data.stop_points.size());
-
     //Construction des connexions entre journey_patternpoints
     //(sert pour les prolongements de service ainsi que les correpondances garanties
     for(const type::JourneyPatternPointConnection* jppc : data.journey_pattern_point_connections) {
@@ -61,49 +54,111 @@ void dataRAPTOR::load(const type::PT_Data &data)
         footpath_rp_backward.insert(std::make_pair(jppc->destination->idx, jppc));
     }
 
+    if(!flat_file || !load_footpaths(data, flat_file)) {
+        build_footpaths(data);
+    }
+    if(!flat_file || !load_timetables(data, flat_file)) {
+        build_timetables(data);
+    }
+
+    for(int i=0; i<=365; ++i) {
+        jp_validity_patterns.push_back(boost::dynamic_bitset<>(data.journey_patterns.size()));
+    }
+
+    for(int i=0; i<=365; ++i) {
+        jp_adapted_validity_pattern.push_back(boost::dynamic_bitset<>(data.journey_patterns.size()));
+    }
+
+    for(const type::JourneyPattern* journey_pattern : data.journey_patterns) {
+        // On dit que le journey pattern est valide en date j s'il y a au moins une circulation à j-1/j+1
+        for(int i=0; i<=365; ++i) {
+            for(auto vj : journey_pattern->vehicle_journey_list) {
+                if(vj->validity_pattern->check2(i)) {
+                    jp_validity_patterns[i].set(journey_pattern->idx);
+                    break;
+                }
+            }
+        }
+
+        // On dit que le journey pattern est valide en date j s'il y a au moins une circulation à j-1/j+1
+        for(int i=0; i<=365; ++i) {
+            for(auto vj : journey_pattern->vehicle_journey_list) {
+                if(vj->adapted_validity_pattern->check2(i)) {
+                    jp_adapted_validity_pattern[i].set(journey_pattern->idx);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void dataRAPTOR::build_footpaths(const type::PT_Data &data) {
+    std::vector<std::map<navitia::type::idx_t, const navitia::type::StopPointConnection*> > footpath_temp_forward, footpath_temp_backward;
+    footpath_temp_forward.resize(data.stop_points.size());
+    footpath_temp_backward.resize(data.stop_points.size());
+
     //Construction de la liste des marche à pied à partir des connexions renseignées
     for(const type::StopPointConnection* connection : data.stop_point_connections) {
         footpath_temp_forward[connection->departure->idx][connection->destination->idx] = connection;
         footpath_temp_backward[connection->departure->idx][connection->destination->idx] = connection;
     }
 
-
-    //On rajoute des connexions entre les stops points d'un même stop area si elles n'existent pas
-    footpath_index_forward.resize(data.stop_points.size());
-    footpath_index_backward.resize(data.stop_points.size());
+    std::vector<uint32_t> foot_path_forward, foot_path_backward, footpath_index_forward, footpath_index_backward;
     for(const type::StopPoint* sp : data.stop_points) {
-        footpath_index_forward[sp->idx].first = foot_path_forward.size();
-        footpath_index_backward[sp->idx].first = foot_path_backward.size();
-        int size_forward = 0, size_backward = 0;
+        footpath_index_forward.push_back(foot_path_forward.size());
+        footpath_index_backward.push_back(foot_path_backward.size());
         for(auto conn : footpath_temp_forward[sp->idx]) {
-            foot_path_forward.push_back(conn.second);
-            ++size_forward;
+            foot_path_forward.push_back(conn.second->idx);
         }
         for(auto conn : footpath_temp_backward[sp->idx]) {
-            foot_path_backward.push_back(conn.second);
-            ++size_backward;
+            foot_path_backward.push_back(conn.second->idx);
         }
+    }
+    footpath_index_forward.push_back(foot_path_forward.size());
+    footpath_index_backward.push_back(foot_path_backward.size());
+
+    this->foot_path_forward.assign(std::move(foot_path_forward));
+    this->foot_path_backward.assign(std::move(foot_path_backward));
+    this->footpath_index_forward.assign(std::move(footpath_index_forward));
+    this->footpath_index_backward.assign(std::move(footpath_index_backward));
+}
 
-        footpath_index_forward[sp->idx].second = size_forward;
-        footpath_index_backward[sp->idx].second = size_backward;
+bool dataRAPTOR::load_footpaths(const type::PT_Data &data, const std::shared_ptr<const type::MappedFlatFile>& flat_file) {
+    try {
+        foot_path_forward.map(flat_file, "raptor.foot_path_forward");
+        foot_path_backward.map(flat_file, "raptor.foot_path_backward");
+        footpath_index_forward.map(flat_file, "raptor.footpath_index_forward");
+        footpath_index_backward.map(flat_file, "raptor.footpath_index_backward");
+    } catch(const navitia::exception&) {
+        return false;
     }
+    // les index doivent être cohérents avec les données, sinon on les recalcule
+    auto valid = [&](const type::FlatVector<uint32_t>& foot_path, const type::FlatVector<uint32_t>& index) {
+        if(index.size() != data.stop_points.size() + 1 || index[0] != 0 || index[index.size() - 1] != foot_path.size()) {
+            return false;
+        }
+        for(size_t sp_idx = 0; sp_idx + 1 < index.size(); ++sp_idx) {
+            if(index[sp_idx + 1] < index[sp_idx]) {
+                return false;
+            }
+            for(uint32_t i = index[sp_idx]; i < index[sp_idx + 1]; ++i) {
+                if(foot_path[i] >= data.stop_point_connections.size()
+                        || data.stop_point_connections[foot_path[i]]->departure->idx != sp_idx) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+    return valid(foot_path_forward, footpath_index_forward) && valid(foot_path_backward, footpath_index_backward);
+}
 
-    typedef std::unordered_map<navitia::type::idx_t, vector_idx> idx_vector_idx;
-    idx_vector_idx ridx_journey_pattern;
-    
-    arrival_times.clear();
-    departure_times.clear();
+void dataRAPTOR::build_timetables(const type::PT_Data &data) {
+    std::vector<uint32_t> arrival_times, departure_times;
     st_idx_forward.clear(); // Nom a changer ce ne sont plus des idx mais des pointeurs
     st_idx_backward.clear(); //
     first_stop_time.clear();
-
-    for(int i=0; i<=365; ++i) {
-        jp_validity_patterns.push_back(boost::dynamic_bitset<>(data.journey_patterns.size()));
-    }
-
-    for(int i=0; i<=365; ++i) {
-        jp_adapted_validity_pattern.push_back(boost::dynamic_bitset<>(data.journey_patterns.size()));
-    }
+    nb_trips.clear();
 
     for(const type::JourneyPattern* journey_pattern : data.journey_patterns) {
         first_stop_time.push_back(arrival_times.size());
@@ -178,29 +233,96 @@ void dataRAPTOR::load(const type::PT_Data &data)
                 arrival_times.push_back(time);
             }
         }
+    }
+    this->arrival_times.assign(std::move(arrival_times));
+    this->departure_times.assign(std::move(departure_times));
+}
 
-        // On dit que le journey pattern est valide en date j s'il y a au moins une circulation à j-1/j+1
-        for(int i=0; i<=365; ++i) {
-            for(auto vj : journey_pattern->vehicle_journey_list) {
-                if(vj->validity_pattern->check2(i)) {
-                    jp_validity_patterns[i].set(journey_pattern->idx);
-                    break;
-                }
-            }
+/** Les stop times sont écrits par l'idx de leur vehicle journey :
+  * le stop time est celui du vehicle journey à l'ordre du journey pattern point
+  */
+void dataRAPTOR::save_flat(type::FlatFileWriter& writer) const {
+    std::vector<uint32_t> vj_forward, vj_backward;
+    for(const type::StopTime* st : st_idx_forward) {
+        vj_forward.push_back(st->vehicle_journey->idx);
+    }
+    for(const type::StopTime* st : st_idx_backward) {
+        vj_backward.push_back(st->vehicle_journey->idx);
+    }
+    writer.add("raptor.vj_forward", vj_forward);
+    writer.add("raptor.vj_backward", vj_backward);
+    writer.add("raptor.arrival_times", std::vector<uint32_t>(arrival_times.begin(), arrival_times.end()));
+    writer.add("raptor.departure_times", std::vector<uint32_t>(departure_times.begin(), departure_times.end()));
+    writer.add("raptor.first_stop_time", std::vector<uint64_t>(first_stop_time.begin(), first_stop_time.end()));
+    writer.add("raptor.foot_path_forward", std::vector<uint32_t>(foot_path_forward.begin(), foot_path_forward.end()));
+    writer.add("raptor.foot_path_backward", std::vector<uint32_t>(foot_path_backward.begin(), foot_path_backward.end()));
+    writer.add("raptor.footpath_index_forward", std::vector<uint32_t>(footpath_index_forward.begin(), footpath_index_forward.end()));
+    writer.add("raptor.footpath_index_backward", std::vector<uint32_t>(footpath_index_backward.begin(), footpath_index_backward.end()));
+}
+
+bool dataRAPTOR::load_timetables(const type::PT_Data &data, const std::shared_ptr<const type::MappedFlatFile>& flat_file) {
+    try {
+        auto first = flat_file->get<uint64_t>("raptor.first_stop_time");
+        auto vj_forward = flat_file->get<uint32_t>("raptor.vj_forward");
+        auto vj_backward = flat_file->get<uint32_t>("raptor.vj_backward");
+        if(first.second != data.journey_patterns.size()) {
+            return false;
         }
 
-        // On dit que le journey pattern est valide en date j s'il y a au moins une circulation à j-1/j+1
-        for(int i=0; i<=365; ++i) {
-            for(auto vj : journey_pattern->vehicle_journey_list) {
-                if(vj->adapted_validity_pattern->check2(i)) {
-                    jp_adapted_validity_pattern[i].set(journey_pattern->idx);
-                    break;
+        std::vector<size_t> first_stop_time, nb_trips;
+        std::vector<type::StopTime*> st_idx_forward(vj_forward.second), st_idx_backward(vj_backward.second);
+        // les stop times sont retrouvés à partir des vehicle journeys, en vérifiant que le fichier correspond aux données
+        auto get_stop_time = [&](uint32_t vj_idx, const type::JourneyPattern* journey_pattern, size_t order) -> type::StopTime* {
+            if(vj_idx >= data.vehicle_journeys.size()) {
+                return nullptr;
+            }
+            const type::VehicleJourney* vj = data.vehicle_journeys[vj_idx];
+            if(vj->journey_pattern != journey_pattern || order >= vj->stop_time_list.size()) {
+                return nullptr;
+            }
+            return vj->stop_time_list[order];
+        };
+        size_t nb_stop_times = 0;
+        for(const type::JourneyPattern* journey_pattern : data.journey_patterns) {
+            const size_t nb = journey_pattern->vehicle_journey_list.size();
+            if(first.first[journey_pattern->idx] != nb_stop_times) {
+                return false;
+            }
+            first_stop_time.push_back(nb_stop_times);
+            nb_trips.push_back(nb);
+            for(size_t order = 0; order < journey_pattern->journey_pattern_point_list.size(); ++order) {
+                if(nb_stop_times + nb > vj_forward.second || nb_stop_times + nb > vj_backward.second) {
+                    return false;
+                }
+                for(size_t i = nb_stop_times; i < nb_stop_times + nb; ++i) {
+                    st_idx_forward[i] = get_stop_time(vj_forward.first[i], journey_pattern, order);
+                    st_idx_backward[i] = get_stop_time(vj_backward.first[i], journey_pattern, order);
+                    if(st_idx_forward[i] == nullptr || st_idx_backward[i] == nullptr) {
+                        return false;
+                    }
                 }
+                nb_stop_times += nb;
             }
         }
-    }
-
+        if(nb_stop_times != vj_forward.second || nb_stop_times != vj_backward.second) {
+            return false;
+        }
 
+        arrival_times.map(flat_file, "raptor.arrival_times");
+        departure_times.map(flat_file, "raptor.departure_times");
+        if(arrival_times.size() != nb_stop_times || departure_times.size() != nb_stop_times) {
+            arrival_times.clear();
+            departure_times.clear();
+            return false;
+        }
+        this->first_stop_time = std::move(first_stop_time);
+        this->nb_trips = std::move(nb_trips);
+        this->st_idx_forward = std::move(st_idx_forward);
+        this->st_idx_backward = std::move(st_idx_backward);
+        return true;
+    } catch(const navitia::exception&) {
+        return false;
+    }
 }
 
 }}
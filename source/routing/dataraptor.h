@@ -32,6 +32,7 @@ www.navitia.io
 #include "type/pt_data.h"
 #include "type/datetime.h"
 #include "routing/raptor_utils.h"
+#include "type/flat_file.h"
 
 #include <boost/foreach.hpp>
 #include <boost/dynamic_bitset.hpp>
@@ -43,14 +44,17 @@ struct dataRAPTOR {
     typedef std::pair<int, int> pair_int;
     typedef std::vector<navitia::type::idx_t> vector_idx;
 
-    std::vector<const navitia::type::StopPointConnection*> foot_path_forward;
-    std::vector<pair_int> footpath_index_forward;
-    std::vector<const navitia::type::StopPointConnection*> foot_path_backward;
-    std::vector<pair_int> footpath_index_backward;
+    /// idx des stop point connections, regroupées par stop point : celles du stop point i
+    /// sont entre footpath_index_*[i] et footpath_index_*[i + 1]
+    type::FlatVector<uint32_t> foot_path_forward;
+    type::FlatVector<uint32_t> footpath_index_forward;
+    type::FlatVector<uint32_t> foot_path_backward;
+    type::FlatVector<uint32_t> footpath_index_backward;
     std::multimap<navitia::type::idx_t,const navitia::type::JourneyPatternPointConnection*> footpath_rp_forward;
     std::multimap<navitia::type::idx_t,const navitia::type::JourneyPatternPointConnection*> footpath_rp_backward;
-    std::vector<uint32_t> arrival_times;
-    std::vector<uint32_t> departure_times;
+    /// horaires de tous les journey pattern points, éventuellement pris directement dans un fichier mappé
+    type::FlatVector<uint32_t> arrival_times;
+    type::FlatVector<uint32_t> departure_times;
     std::vector<uint32_t> start_times_frequencies;
     std::vector<uint32_t> end_times_frequencies;
     std::vector<type::StopTime*> st_idx_forward;// Nom a changer ce ne sont plus des idx mais des pointeurs
@@ -65,7 +69,15 @@ struct dataRAPTOR {
 
 
     dataRAPTOR()  {}
-    void load(const navitia::type::PT_Data &data);
+    /** Construit les données
+      *
+      * Les horaires et les correspondances sont pris dans le fichier à plat s'il y en a un et qu'il correspond
+      * aux données, sinon ils sont calculés (ce qui nécessite de trier les horaires de chaque journey pattern point)
+      */
+    void load(const navitia::type::PT_Data &data, const std::shared_ptr<const type::MappedFlatFile>& flat_file = nullptr);
+
+    /// Ajoute les horaires et les correspondances au fichier à plat
+    void save_flat(type::FlatFileWriter& writer) const;
 
     const std::multimap<navitia::type::idx_t, const navitia::type::JourneyPatternPointConnection*> & footpath_rp(bool forward) const {
         if(forward)
@@ -100,18 +112,24 @@ struct dataRAPTOR {
         return type::invalid_idx;
     }
 
-    inline type::idx_t get_stop_point_connection_idx(type::idx_t stop_point_idx_origin, type::idx_t stop_point_idx_destination, bool clockwise,const navitia::type::PT_Data &/*data*/)  const {
+    inline type::idx_t get_stop_point_connection_idx(type::idx_t stop_point_idx_origin, type::idx_t stop_point_idx_destination, bool clockwise,const navitia::type::PT_Data &data)  const {
 
-        const std::vector<const type::StopPointConnection*> &foot_path = clockwise ? foot_path_forward : foot_path_backward;
-        const std::vector<pair_int> &footpath_index = clockwise ? footpath_index_forward : footpath_index_backward;
-        for(int i = footpath_index[stop_point_idx_origin].first; i < footpath_index[stop_point_idx_origin].second; ++i) {
-            auto conn = foot_path[i];
+        const auto &foot_path = clockwise ? foot_path_forward : foot_path_backward;
+        const auto &footpath_index = clockwise ? footpath_index_forward : footpath_index_backward;
+        for(uint32_t i = footpath_index[stop_point_idx_origin]; i < footpath_index[stop_point_idx_origin + 1]; ++i) {
+            auto conn = data.stop_point_connections[foot_path[i]];
             if(conn->destination->idx == stop_point_idx_destination) {
                 return conn->idx;
             }
         }
         return type::invalid_idx;
     }
+
+private:
+    void build_footpaths(const navitia::type::PT_Data &data);
+    bool load_footpaths(const navitia::type::PT_Data &data, const std::shared_ptr<const type::MappedFlatFile>& flat_file);
+    void build_timetables(const navitia::type::PT_Data &data);
+    bool load_timetables(const navitia::type::PT_Data &data, const std::shared_ptr<const type::MappedFlatFile>& flat_file);
 };
 
 }}
@@ -76,10 +76,10 @@ RAPTOR::journey_pattern_path_connections(const Visitor & visitor/*,
 template<typename Visitor>
 void RAPTOR::foot_path(const Visitor & v, const type::Properties &required_properties) {
 
-    int last = 0;
-    const auto foot_path_list = v.clockwise() ? data.dataRaptor->foot_path_forward :
-                                                data.dataRaptor->foot_path_backward;
-    auto it = foot_path_list.begin();
+    const auto &foot_path_list = v.clockwise() ? data.dataRaptor->foot_path_forward :
+                                                 data.dataRaptor->foot_path_backward;
+    const auto &footpath_index = v.clockwise() ? data.dataRaptor->footpath_index_forward :
+                                                 data.dataRaptor->footpath_index_backward;
     auto &current_labels = labels[count];
     for(auto stop_point_idx = marked_sp.find_first(); stop_point_idx != marked_sp.npos;
         stop_point_idx = marked_sp.find_next(stop_point_idx)) {
@@ -119,17 +119,11 @@ void RAPTOR::foot_path(const Visitor & v, const type::Properties &required_prope
                     }
                 }
                 //On va maintenant chercher toutes les connexions et on marque tous les journey_pattern_points concernés
-                //On récupère l'index dans les footpath
-                const pair_int & index = (v.clockwise()) ? data.dataRaptor->footpath_index_forward[stop_point_idx] :
-                                                         data.dataRaptor->footpath_index_backward[stop_point_idx];
                 //int prec_duration = -1;
                 DateTime next = v.worst_datetime(),
                          previous = current_labels[best_jpp].dt;
-                it += index.first - last;
-                const auto end = it + index.second;
-
-                for(; it != end; ++it) {
-                    const type::StopPointConnection* spc = *it;
+                for(uint32_t i = footpath_index[stop_point_idx]; i < footpath_index[stop_point_idx + 1]; ++i) {
+                    const type::StopPointConnection* spc = data.pt_data->stop_point_connections[foot_path_list[i]];
                     const auto destination = spc->destination;
                     next = v.combine(previous, spc->duration); // ludo
                     if(destination->accessible(required_properties)) {
@@ -150,7 +144,6 @@ void RAPTOR::foot_path(const Visitor & v, const type::Properties &required_prope
                         }
                     }
                 }
-                last = index.first + index.second;
             }
         }
     }
@@ -231,6 +224,7 @@ RAPTOR::compute_all(const std::vector<std::pair<type::idx_t, bt::time_duration>
                     const std::vector<std::string> & forbidden,
                     bool clockwise) {
     std::vector<Path> result;
+    realtime_overlay = data.get_realtime_overlay();
     set_journey_patterns_valides(DateTimeUtils::date(departure_datetime), forbidden, disruption_active);
 
     auto calc_dep = clockwise ? departures_ : destinations;
@@ -240,6 +234,9 @@ RAPTOR::compute_all(const std::vector<std::pair<type::idx_t, bt::time_duration>
     clear_and_init(departures, calc_dest, bound, clockwise);
 
     boucleRAPTOR(accessibilite_params, clockwise, disruption_active, false, max_transfers);
+    if(deadline_reached) {
+        throw DeadlineExceeded();
+    }
     //auto tmp = makePathes(calc_dest, bound, accessibilite_params, *this, clockwise, disruption_active);
     //result.insert(result.end(), tmp.begin(), tmp.end());
     // Aucune solution n’a été trouvée :'(
@@ -250,11 +247,18 @@ RAPTOR::compute_all(const std::vector<std::pair<type::idx_t, bt::time_duration>
         //Second passe : permet d’optimiser les temps de correspondance
         departures = get_solutions(calc_dep, calc_dest, !clockwise,
                                    labels,
-                                   accessibilite_params, data, disruption_active);
+                                   accessibilite_params, data, disruption_active, realtime_overlay.get());
         for(auto departure : departures) {
             clear_and_init({departure}, calc_dep, departure_datetime, !clockwise);
 
             boucleRAPTOR(accessibilite_params, !clockwise, disruption_active, true, max_transfers);
+            if(deadline_reached) {
+                // the journeys already built are returned, the others are dropped
+                if(result.empty()) {
+                    throw DeadlineExceeded();
+                }
+                break;
+            }
 
             if(b_dest.best_now_jpp_idx != type::invalid_idx) {
                 std::vector<Path> temp = makePathes(calc_dest, calc_dep, accessibilite_params, *this, !clockwise, disruption_active);
@@ -272,11 +276,15 @@ RAPTOR::isochrone(const std::vector<std::pair<type::idx_t, bt::time_duration> >
           const type::AccessibiliteParams & accessibilite_params,
           const std::vector<std::string> & forbidden,
           bool clockwise, bool disruption_active) {
+    realtime_overlay = data.get_realtime_overlay();
     set_journey_patterns_valides(DateTimeUtils::date(departure_datetime), forbidden, disruption_active);
     auto departures = get_solutions(departures_, departure_datetime, true, data, disruption_active);
     clear_and_init(departures, {}, bound, true);
 
     boucleRAPTOR(accessibilite_params, clockwise, true, max_transfers);
+    if(deadline_reached) {
+        throw DeadlineExceeded();
+    }
 }
 
 
@@ -386,10 +394,20 @@ void RAPTOR::raptor_loop(Visitor visitor, const type::AccessibiliteParams & acce
     const type::JourneyPatternPoint* boarding = nullptr; //< Le JPP time auquel on a embarqué
     DateTime workingDt = visitor.worst_datetime();
     uint32_t l_zone = std::numeric_limits<uint32_t>::max();
+    const type::RealtimeOverlay* overlay = realtime_overlay.get();
+    // Modification temps réel de la course embarquée : on ne descend pas aux arrêts qu'elle ne dessert pas.
+    // Une course suivante de la même journey_pattern desservant l'arrêt n'est trouvée qu'au tour suivant.
+    const type::TripUpdate* boarded_update = nullptr;
 
     //this->foot_path(visitor, accessibilite_params.properties);
     uint32_t nb_jpp_visites = 0;
+    deadline_reached = false;
     while(!end && count <= max_transfers) {
+        if(deadline_passed(deadline)) {
+            // the labels of the last rounds are incomplete, the caller decides what to do with them
+            deadline_reached = true;
+            return;
+        }
         ++count;
         end = true;
         if(count == labels.size()) {
@@ -409,6 +427,7 @@ void RAPTOR::raptor_loop(Visitor visitor, const type::AccessibiliteParams & acce
                     && journey_patterns_valides.test(journey_pattern->idx)) {
                 nb_jpp_visites ++;
                 boarding = nullptr;
+                boarded_update = nullptr;
                 workingDt = visitor.worst_datetime();
                 typename Visitor::stop_time_iterator it_st;
                 const auto & jpp_to_explore = visitor.journey_pattern_points(
@@ -426,7 +445,8 @@ void RAPTOR::raptor_loop(Visitor visitor, const type::AccessibiliteParams & acce
                         DateTimeUtils::update(workingDt, current_time, visitor.clockwise());
                         if((l_zone == std::numeric_limits<uint32_t>::max()
                             || l_zone != st->local_traffic_zone)
-                                && st->valid_end(visitor.clockwise())) {
+                                && st->valid_end(visitor.clockwise())
+                                && !(boarded_update != nullptr && boarded_update->skips(st->journey_pattern_point->order))) {
                             //On stocke le meilleur label, et on marque pour explorer par la suite
                             const DateTime bound = (visitor.comp(best_labels[jpp_idx], b_dest.best_now) || !global_pruning) ?
                                                     best_labels[jpp_idx] : b_dest.best_now;
@@ -459,9 +479,13 @@ void RAPTOR::raptor_loop(Visitor visitor, const type::AccessibiliteParams & acce
                        (boarding == nullptr || visitor.better_or_equal(labels_temp, workingDt, *it_st))) {
                         const auto tmp_st_dt = best_stop_time(jpp, labels_temp,
                                                                 accessibilite_params.vehicle_properties,
-                                                                visitor.clockwise(), disruption_active, data);
+                                                                visitor.clockwise(), disruption_active, data,
+                                                                false, overlay);
                         if(tmp_st_dt.first != nullptr) {
                             boarding = jpp;
+                            boarded_update = type::trip_update(overlay, tmp_st_dt.first,
+                                                               DateTimeUtils::date(tmp_st_dt.second),
+                                                               visitor.clockwise());
                             it_st = visitor.first_stoptime(tmp_st_dt.first);
                             workingDt = tmp_st_dt.second;
                             BOOST_ASSERT(visitor.comp(labels_temp, workingDt) || labels_temp == workingDt);
@@ -42,6 +42,7 @@ www.navitia.io
 #include "raptor_path.h"
 #include "raptor_solutions.h"
 #include "raptor_utils.h"
+#include "type/deadline.h"
 
 namespace navitia { namespace routing {
 
@@ -67,6 +68,12 @@ struct RAPTOR
     boost::dynamic_bitset<> journey_patterns_valides;
     ///L'ordre du premier j: public AbstractRouterourney_pattern point de la journey_pattern
     queue_t Q;
+    ///Échéance (UTC) du calcul en cours, vérifiée à chaque tour ; not_a_date_time pour aucune
+    boost::posix_time::ptime deadline;
+    ///Est-ce que le dernier parcours a été interrompu par l'échéance
+    bool deadline_reached = false;
+    ///Temps réel figé au début du calcul : les courses supprimées et les arrêts non desservis sont ignorés
+    std::shared_ptr<const type::RealtimeOverlay> realtime_overlay;
 
     //Constructeur
     RAPTOR(const navitia::type::Data &data) :
@@ -370,6 +370,7 @@ make_response(RAPTOR &raptor, const type::EntryPoint &origin,
 
     DateTime bound = clockwise ? DateTimeUtils::inf : DateTimeUtils::min;
 
+    std::vector<bt::ptime> computed_datetimes;
     for(bt::ptime datetime : datetimes) {
         int day = (datetime.date() - raptor.data.meta->production_date.begin()).days();
         int time = datetime.time_of_day().total_seconds();
@@ -379,7 +380,17 @@ make_response(RAPTOR &raptor, const type::EntryPoint &origin,
             bound = clockwise ? init_dt + max_duration : init_dt - max_duration;
         }
 
-        std::vector<Path> tmp = raptor.compute_all(departures, destinations, init_dt, disruption_active, bound, max_transfers, accessibilite_params, forbidden, clockwise);
+        std::vector<Path> tmp;
+        try {
+            tmp = raptor.compute_all(departures, destinations, init_dt, disruption_active, bound, max_transfers, accessibilite_params, forbidden, clockwise);
+        } catch(const DeadlineExceeded&) {
+            // the journeys of the datetimes already computed are returned
+            if(computed_datetimes.empty()) {
+                throw;
+            }
+            break;
+        }
+        computed_datetimes.push_back(datetime);
 
         // Lorsqu'on demande qu'un seul horaire, on garde tous les résultas
         if(datetimes.size() == 1) {
@@ -398,7 +409,7 @@ make_response(RAPTOR &raptor, const type::EntryPoint &origin,
     if(clockwise)
         std::reverse(result.begin(), result.end());
 
-    return make_pathes(result, raptor.data, worker, origin, destination, datetimes, clockwise, show_codes);
+    return make_pathes(result, raptor.data, worker, origin, destination, computed_datetimes, clockwise, show_codes);
 }
 
 
@@ -42,7 +42,7 @@ makePathes(const std::vector<std::pair<type::idx_t, boost::posix_time::time_dura
            const type::AccessibiliteParams & accessibilite_params, const RAPTOR &raptor_,
            bool clockwise, bool disruption_active) {
     std::vector<Path> result;
-    auto solutions = get_solutions(departures, destinations, !clockwise, raptor_.labels, accessibilite_params, raptor_.data, disruption_active);
+    auto solutions = get_solutions(departures, destinations, !clockwise, raptor_.labels, accessibilite_params, raptor_.data, disruption_active, raptor_.realtime_overlay.get());
     for(Solution solution : solutions) {
         result.push_back(makePath(solution.rpidx, solution.count, clockwise, disruption_active, accessibilite_params, raptor_));
     }
@@ -52,11 +52,12 @@ makePathes(const std::vector<std::pair<type::idx_t, boost::posix_time::time_dura
 
 std::pair<const type::StopTime*, uint32_t>
 get_current_stidx_gap(size_t count, type::idx_t journey_pattern_point, const std::vector<label_vector_t> &labels,
-                      const type::AccessibiliteParams & accessibilite_params, bool clockwise,  const navitia::type::Data &data, bool disruption_active) {
+                      const type::AccessibiliteParams & accessibilite_params, bool clockwise,  const navitia::type::Data &data, bool disruption_active,
+                      const type::RealtimeOverlay* overlay) {
     const auto& label = labels[count][journey_pattern_point];
     if(label.type == boarding_type::vj) {
         const type::JourneyPatternPoint* jpp = data.pt_data->journey_pattern_points[journey_pattern_point];
-        return best_stop_time(jpp, label.dt, accessibilite_params.vehicle_properties, clockwise, disruption_active, data, true);
+        return best_stop_time(jpp, label.dt, accessibilite_params.vehicle_properties, clockwise, disruption_active, data, true, overlay);
     }
     return std::make_pair(nullptr, std::numeric_limits<uint32_t>::max());
 }
@@ -132,7 +133,7 @@ makePath(type::idx_t destination_idx, unsigned int countb, bool clockwise, bool
                 //BOOST_ASSERT(result.items.empty() || clockwise &&  (l >= result.items.back().arrival));
                 boarding_jpp = raptor_.get_boarding_jpp(countb, current_jpp_idx)->idx;
 
-                std::tie(current_st, workingDate) = get_current_stidx_gap(countb, current_jpp_idx, raptor_.labels, accessibilite_params, clockwise,  raptor_.data, disruption_active) ;
+                std::tie(current_st, workingDate) = get_current_stidx_gap(countb, current_jpp_idx, raptor_.labels, accessibilite_params, clockwise,  raptor_.data, disruption_active, raptor_.realtime_overlay.get());
                 item = PathItem();
                 item.type = public_transport;
                 while(boarding_jpp != current_jpp_idx) {
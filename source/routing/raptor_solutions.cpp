@@ -38,10 +38,10 @@ get_solutions(const std::vector<std::pair<type::idx_t, bt::time_duration> > &dep
              const std::vector<std::pair<type::idx_t, bt::time_duration> > &destinations,
              bool clockwise, const std::vector<label_vector_t> &labels,
              const type::AccessibiliteParams & accessibilite_params, const type::Data &data,
-             bool disruption_active) {
+             bool disruption_active, const type::RealtimeOverlay* overlay) {
       Solutions result;
       auto pareto_front = get_pareto_front(clockwise, departs, destinations, labels,
-              accessibilite_params, data, disruption_active);
+              accessibilite_params, data, disruption_active, overlay);
       result.insert(pareto_front.begin(), pareto_front.end());
 
       if(!pareto_front.empty()) {
@@ -87,7 +87,8 @@ Solutions
 get_pareto_front(bool clockwise, const std::vector<std::pair<type::idx_t, bt::time_duration> > &departs,
                const std::vector<std::pair<type::idx_t, bt::time_duration> > &destinations,
                const std::vector<label_vector_t> &labels,
-               const type::AccessibiliteParams & accessibilite_params, const type::Data &data, bool disruption_active){
+               const type::AccessibiliteParams & accessibilite_params, const type::Data &data, bool disruption_active,
+               const type::RealtimeOverlay* overlay){
     Solutions result;
 
     DateTime best_dt, best_dt_jpp;
@@ -118,7 +119,7 @@ get_pareto_front(bool clockwise, const std::vector<std::pair<type::idx_t, bt::ti
                     const type::StopTime* st;
                     DateTime dt = 0;
 
-                    std::tie(st, dt) = best_stop_time(journey_pattern_point, l.dt, accessibilite_params.vehicle_properties, !clockwise, disruption_active, data, true);
+                    std::tie(st, dt) = best_stop_time(journey_pattern_point, l.dt, accessibilite_params.vehicle_properties, !clockwise, disruption_active, data, true, overlay);
                     BOOST_ASSERT(st);
                     if(st != nullptr) {
                         if(clockwise) {
@@ -74,7 +74,7 @@ Solutions
 get_solutions(const std::vector<std::pair<type::idx_t, boost::posix_time::time_duration> > &departs,
              const std::vector<std::pair<type::idx_t, boost::posix_time::time_duration> > &destinations, bool clockwise,
              const std::vector<label_vector_t> &labels, const type::AccessibiliteParams & accessibilite_params,
-             const type::Data &data, bool disruption_active);
+             const type::Data &data, bool disruption_active, const type::RealtimeOverlay* overlay = nullptr);
 
 //This one is hacky, it's used to retrieve the departures.
 Solutions
@@ -90,7 +90,8 @@ Solutions
 get_pareto_front(bool clockwise, const std::vector<std::pair<type::idx_t, boost::posix_time::time_duration> > &departs,
                const std::vector<std::pair<type::idx_t, boost::posix_time::time_duration> > &destinations,
                const std::vector<label_vector_t> &labels,
-               const type::AccessibiliteParams & accessibilite_params, const type::Data &data, bool disruption_active);
+               const type::AccessibiliteParams & accessibilite_params, const type::Data &data, bool disruption_active,
+               const type::RealtimeOverlay* overlay = nullptr);
 
 std::pair<type::idx_t, DateTime>
 get_final_jppidx_and_date(int count, type::idx_t jpp_idx, bool clockwise, const std::vector<label_vector_t> &labels);
@@ -34,6 +34,8 @@ www.navitia.io
 
 #include "routing/raptor.h"
 #include "ed/build_helper.h"
+#include "type/flat_file.h"
+#include <boost/filesystem.hpp>
 
 
 using namespace navitia;
@@ -802,3 +804,112 @@ BOOST_AUTO_TEST_CASE(max_transfers){
     }
 }
 
+
+BOOST_AUTO_TEST_CASE(flat_timetables){
+    ed::builder b("20120614");
+    b.vj("A")("stop1", 8000, 8050)("stop2", 8100,8150)("stop3", 8200, 8250);
+    b.vj("A")("stop1", 9000, 9050)("stop2", 9100,9150)("stop3", 9200, 9250);
+    b.vj("A")("stop1", 7000, 7050)("stop2", 7100,7150)("stop3", 7200, 7250);
+    b.vj("B")("stop3", 8000, 8050)("stop1", 8100,8150);
+    b.connection("stop1", "stop2", 120);
+    b.connection("stop3", "stop1", 60);
+    b.data->pt_data->index();
+    b.data->build_raptor();
+
+    const std::string filename = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+    type::FlatFileWriter writer;
+    b.data->dataRaptor->save_flat(writer);
+    writer.write(filename);
+
+    dataRAPTOR mapped;
+    mapped.load(*b.data->pt_data, std::make_shared<const type::MappedFlatFile>(filename));
+    boost::filesystem::remove(filename); // the mapping stays valid
+    const dataRAPTOR& computed = *b.data->dataRaptor;
+
+    BOOST_CHECK(mapped.arrival_times.is_mapped());
+    BOOST_CHECK(mapped.departure_times.is_mapped());
+    BOOST_CHECK_EQUAL_COLLECTIONS(mapped.arrival_times.begin(), mapped.arrival_times.end(),
+                                  computed.arrival_times.begin(), computed.arrival_times.end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(mapped.departure_times.begin(), mapped.departure_times.end(),
+                                  computed.departure_times.begin(), computed.departure_times.end());
+    BOOST_CHECK(mapped.st_idx_forward == computed.st_idx_forward);
+    BOOST_CHECK(mapped.st_idx_backward == computed.st_idx_backward);
+    BOOST_CHECK(mapped.first_stop_time == computed.first_stop_time);
+    BOOST_CHECK(mapped.nb_trips == computed.nb_trips);
+    BOOST_CHECK(mapped.foot_path_forward.is_mapped());
+    BOOST_CHECK_EQUAL_COLLECTIONS(mapped.foot_path_forward.begin(), mapped.foot_path_forward.end(),
+                                  computed.foot_path_forward.begin(), computed.foot_path_forward.end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(mapped.footpath_index_backward.begin(), mapped.footpath_index_backward.end(),
+                                  computed.footpath_index_backward.begin(), computed.footpath_index_backward.end());
+    const type::idx_t connection_idx = mapped.get_stop_point_connection_idx(b.sps["stop3"]->idx, b.sps["stop1"]->idx, true, *b.data->pt_data);
+    BOOST_REQUIRE(connection_idx != type::invalid_idx);
+    BOOST_CHECK_EQUAL(b.data->pt_data->stop_point_connections[connection_idx]->duration, 60);
+
+    //a flat file that does not match the data is not used
+    ed::builder b2("20120614");
+    b2.vj("A")("stop1", 8000, 8050)("stop2", 8100,8150);
+    b2.vj("B")("stop1", 8000, 8050)("stop2", 8100,8150)("stop3", 8200, 8250);
+    b2.data->pt_data->index();
+    writer.write(filename);
+    dataRAPTOR other;
+    other.load(*b2.data->pt_data, std::make_shared<const type::MappedFlatFile>(filename));
+    boost::filesystem::remove(filename);
+    BOOST_CHECK(!other.arrival_times.is_mapped());
+    BOOST_CHECK_EQUAL(other.arrival_times.size(), 5);
+    BOOST_CHECK(!other.foot_path_forward.is_mapped());
+}
+
+BOOST_AUTO_TEST_CASE(deadline){
+    ed::builder b("20120614");
+    b.vj("A")("stop1", 8000, 8050)("stop2", 8100,8150);
+    b.data->pt_data->index();
+    b.data->build_raptor();
+    RAPTOR raptor(*b.data);
+
+    raptor.deadline = bt::microsec_clock::universal_time() - bt::seconds(1);
+    BOOST_CHECK_THROW(raptor.compute(b.data->pt_data->stop_areas[0], b.data->pt_data->stop_areas[1], 7900, 0, DateTimeUtils::inf, false),
+                      DeadlineExceeded);
+
+    raptor.deadline = bt::microsec_clock::universal_time() + bt::hours(1);
+    auto res = raptor.compute(b.data->pt_data->stop_areas[0], b.data->pt_data->stop_areas[1], 7900, 0, DateTimeUtils::inf, false);
+    BOOST_CHECK_EQUAL(res.size(), 1);
+}
+
+/// les courses supprimées et les arrêts non desservis en temps réel ne sont pas proposés
+BOOST_AUTO_TEST_CASE(realtime_overlay){
+    ed::builder b("20120614");
+    b.vj("A")("stop1", 8000, 8050)("stop2", 8100,8150)("stop3", 8200, 8250);
+    b.vj("B")("stop1", 9000, 9050)("stop2", 9100,9150)("stop3", 9200, 9250);
+    b.data->pt_data->index();
+    b.data->build_raptor();
+    RAPTOR raptor(*b.data);
+
+    auto overlay = std::make_shared<type::RealtimeOverlay>();
+    type::TripUpdate cancellation;
+    cancellation.cancelled = true;
+    overlay->set(b.data->pt_data->vehicle_journeys[0], 0, cancellation);
+    b.data->set_realtime_overlay(overlay);
+
+    auto res = raptor.compute(b.data->pt_data->stop_areas[0], b.data->pt_data->stop_areas[2], 7900, 0, DateTimeUtils::inf, false);
+    BOOST_REQUIRE_EQUAL(res.size(), 1);
+    BOOST_REQUIRE_EQUAL(res.back().items.size(), 1);
+    BOOST_CHECK_EQUAL(res.back().items[0].departure.time_of_day().total_seconds(), 9050);
+    BOOST_CHECK_EQUAL(res.back().items[0].arrival.time_of_day().total_seconds(), 9200);
+
+    //la course A circule mais ne dessert pas stop2
+    overlay = std::make_shared<type::RealtimeOverlay>();
+    type::TripUpdate skip;
+    skip.skipped_orders = {1};
+    overlay->set(b.data->pt_data->vehicle_journeys[0], 0, skip);
+    b.data->set_realtime_overlay(overlay);
+
+    res = raptor.compute(b.data->pt_data->stop_areas[0], b.data->pt_data->stop_areas[1], 7900, 0, DateTimeUtils::inf, false);
+    BOOST_REQUIRE_EQUAL(res.size(), 1);
+    BOOST_CHECK_EQUAL(res.back().items[0].departure.time_of_day().total_seconds(), 9050);
+    BOOST_CHECK_EQUAL(res.back().items[0].arrival.time_of_day().total_seconds(), 9100);
+
+    res = raptor.compute(b.data->pt_data->stop_areas[0], b.data->pt_data->stop_areas[2], 7900, 0, DateTimeUtils::inf, false);
+    BOOST_REQUIRE_EQUAL(res.size(), 1);
+    BOOST_CHECK_EQUAL(res.back().items[0].departure.time_of_day().total_seconds(), 8050);
+    BOOST_CHECK_EQUAL(res.back().items[0].arrival.time_of_day().total_seconds(), 8200);
+}
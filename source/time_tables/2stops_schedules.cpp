@@ -30,11 +30,41 @@ www.navitia.io
 
 #include "2stops_schedules.h"
 #include "type/meta_data.h"
+#include <algorithm>
 
 namespace pt = boost::posix_time;
 namespace navitia { namespace timetables {
 
 
+std::unordered_map<type::idx_t, uint32_t> get_arrival_order(const std::vector<type::idx_t> &departure_journey_pattern_points,
+                                                            const std::vector<type::idx_t> &arrival_journey_pattern_points,
+                                                            const type::Data & data) {
+    //Ordres des arrivées de chaque journey pattern, triés
+    std::unordered_map<type::idx_t, std::vector<uint32_t>> arrival_orders_by_jp;
+    for(type::idx_t idx : arrival_journey_pattern_points) {
+        const auto jpp = data.pt_data->journey_pattern_points[idx];
+        arrival_orders_by_jp[jpp->journey_pattern->idx].push_back(jpp->order);
+    }
+    for(auto& jp_orders : arrival_orders_by_jp) {
+        std::sort(jp_orders.second.begin(), jp_orders.second.end());
+    }
+
+    std::unordered_map<type::idx_t, uint32_t> result;
+    for(type::idx_t idx : departure_journey_pattern_points) {
+        const auto jpp = data.pt_data->journey_pattern_points[idx];
+        const auto it_jp = arrival_orders_by_jp.find(jpp->journey_pattern->idx);
+        if(it_jp == arrival_orders_by_jp.end()) {
+            continue;
+        }
+        const auto it_order = std::upper_bound(it_jp->second.begin(), it_jp->second.end(), uint32_t(jpp->order));
+        if(it_order != it_jp->second.end()) {
+            result.insert(std::make_pair(idx, *it_order));
+        }
+    }
+    return result;
+}
+
+
 std::vector<pair_dt_st> stops_schedule(const std::string &departure_filter, const std::string &arrival_filter,
                                        const std::vector<std::string>& forbidden_uris,
                                         const DateTime &datetime, const DateTime &max_datetime,
@@ -47,30 +77,38 @@ std::vector<pair_dt_st> stops_schedule(const std::string &departure_filter, cons
     auto arrival_journey_pattern_points = ptref::make_query(type::Type_e::JourneyPatternPoint,
                                                     arrival_filter, forbidden_uris, data);
 
-    std::unordered_map<type::idx_t, size_t> departure_idx_arrival_order;
-    for(type::idx_t idx : departure_journey_pattern_points) {
-        const auto & jpp = data.pt_data->journey_pattern_points[idx];
-        auto it_idx = std::find_if(arrival_journey_pattern_points.begin(), arrival_journey_pattern_points.end(),
-                                  [&](type::idx_t idx2)
-                                  {return data.pt_data->journey_pattern_points[idx2]->journey_pattern == jpp->journey_pattern;});
-        if(it_idx != arrival_journey_pattern_points.end() && jpp->order < data.pt_data->journey_pattern_points[*it_idx]->order)
-            departure_idx_arrival_order.insert(std::make_pair(idx, data.pt_data->journey_pattern_points[*it_idx]->order));
-    }
+    const auto departure_idx_arrival_order = get_arrival_order(departure_journey_pattern_points,
+                                                               arrival_journey_pattern_points, data);
     //On ne garde que departure qui sont dans les deux sets, et dont l'ordre est bon.
-    std::remove_if(departure_journey_pattern_points.begin(), departure_journey_pattern_points.end(),
-               [&](type::idx_t idx){return departure_idx_arrival_order.find(idx) == departure_idx_arrival_order.end(); });
+    departure_journey_pattern_points.erase(
+            std::remove_if(departure_journey_pattern_points.begin(), departure_journey_pattern_points.end(),
+               [&](type::idx_t idx){return departure_idx_arrival_order.find(idx) == departure_idx_arrival_order.end(); }),
+            departure_journey_pattern_points.end());
+    if(departure_journey_pattern_points.empty()) {
+        return result;
+    }
 
     //On demande tous les next_departures
-    auto departure_dt_st = get_stop_times(departure_journey_pattern_points, datetime, max_datetime, std::numeric_limits<int>::max(), data, disruption_active);
-
-    //On va chercher les retours
-    for(auto dep_dt_st : departure_dt_st) {
+    std::vector<uint32_t> circulation_dates;
+    auto departure_dt_st = get_stop_times(departure_journey_pattern_points, datetime, max_datetime, std::numeric_limits<int>::max(),
+                                          data, disruption_active, {}, type::AccessibiliteParams(), &circulation_dates);
+    const auto overlay = data.get_realtime_overlay();
+
+    //On va chercher les retours : l'arrivée est sur la même course, à l'ordre trouvé par le matching
+    result.reserve(departure_dt_st.size());
+    for(size_t i = 0; i < departure_dt_st.size(); ++i) {
+        const auto& dep_dt_st = departure_dt_st[i];
         const type::StopTime* departure_st = dep_dt_st.second;
         const type::VehicleJourney* vj = departure_st->vehicle_journey;
-        const uint32_t arrival_order = departure_idx_arrival_order[departure_st->journey_pattern_point->idx];
+        const uint32_t arrival_order = departure_idx_arrival_order.at(departure_st->journey_pattern_point->idx);
+        // la course ne dépose pas de voyageurs à l'arrivée si elle ne la dessert plus
+        const type::TripUpdate* update = overlay->get(vj->idx, circulation_dates[i]);
+        if(update != nullptr && update->skips(arrival_order)) {
+            continue;
+        }
         const type::StopTime* arrival_st = vj->stop_time_list[arrival_order];
-        DateTime arrival_dt = dep_dt_st.first;
-        DateTimeUtils::update(arrival_dt, arrival_st->arrival_time);
+        // le temps de parcours de la course garde le retard temps réel du départ
+        const DateTime arrival_dt = dep_dt_st.first + arrival_st->arrival_time - departure_st->departure_time;
         result.push_back(std::make_pair(dep_dt_st, std::make_pair(arrival_dt, arrival_st)));
     }
 
@@ -40,14 +40,17 @@ namespace navitia { namespace timetables {
 typedef std::pair<datetime_stop_time, datetime_stop_time> pair_dt_st;
 
 /**
- * @brief get_arrival_order : Fait un matching entre les journey_pattern points de departure_journey_patternpoint et ceux obtenus via arrival_filter.
+ * @brief get_arrival_order : Fait un matching entre les journey_pattern points de départ et ceux d'arrivée.
  *                            Le matching est effectué si les deux journey_pattern_points appartiennent à la même journey_pattern, et que l'ordre du journey_pattern_point de départ est inférieur à celui d'arrivée.
- * @param departure_journey_patternpoint : Les journey_pattern_points de départs
- * @param arrival_filter : Les journey_pattern points d'arrivée
+ *                            Si plusieurs arrivées conviennent, c'est la plus proche du départ qui est retenue.
+ * @param departure_journey_pattern_points : Les journey_pattern_points de départ
+ * @param arrival_journey_pattern_points : Les journey_pattern_points d'arrivée
  * @param data : Un objet data
  * @return : Renvoie l'idx des journey_patterns points de départ et l'ordre des journey_pattern points de d'arrivée
  */
-std::unordered_map<type::idx_t, uint32_t> get_arrival_order(const std::vector<type::idx_t> &departure_journey_patternpoint, const std::string &arrival_filter, type::Data & data);
+std::unordered_map<type::idx_t, uint32_t> get_arrival_order(const std::vector<type::idx_t> &departure_journey_pattern_points,
+                                                            const std::vector<type::idx_t> &arrival_journey_pattern_points,
+                                                            const type::Data & data);
 
 /**
  * @brief departure_board : Renvoie un vecteur de paires de DateTime/StopTime, correspondant au matching effectué par departure_board
@@ -0,0 +1,156 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#include "day_index.h"
+#include "routing/dataraptor.h"
+#include "routing/best_stoptime.h"
+#include "type/meta_data.h"
+#include <algorithm>
+
+namespace navitia { namespace timetables {
+
+DayIndex::DayIndex(const type::Data& data, uint32_t date, bool disruption_active) :
+    data(data), date(date), disruption_active(disruption_active),
+    slots(new Slot[data.pt_data->journey_pattern_points.size()]) {}
+
+
+const DayIndex::Departures& DayIndex::departures(type::idx_t jpp_idx) const {
+    Slot& slot = slots[jpp_idx];
+    // les requêtes concurrentes sur le même journey pattern point attendent la première construction
+    std::call_once(slot.built, [&]() {
+        slot.departures.reset(new Departures(build(jpp_idx)));
+    });
+    return *slot.departures;
+}
+
+
+DayIndex::Departures DayIndex::build(type::idx_t jpp_idx) const {
+    const auto& raptor = *data.dataRaptor;
+    const type::JourneyPatternPoint* jpp = data.pt_data->journey_pattern_points[jpp_idx];
+    const type::JourneyPattern* jp = jpp->journey_pattern;
+    const size_t begin = raptor.first_stop_time[jp->idx] + jpp->order * raptor.nb_trips[jp->idx];
+    const size_t end = begin + raptor.nb_trips[jp->idx];
+    Departures result;
+    // les horaires de raptor sont triés par heure, on garde l'ordre en filtrant
+    for(size_t idx = begin; idx < end; ++idx) {
+        const type::StopTime* st = raptor.st_idx_forward[idx];
+        if(st->is_frequency()) {
+            Departures not_indexed;
+            not_indexed.indexed = false;
+            return not_indexed;
+        }
+        const auto* validity_pattern = disruption_active ? st->arrival_adapted_validity_pattern : st->arrival_validity_pattern;
+        if(st->valid_end(false) && validity_pattern->check(date)) {
+            result.departure_times.push_back(raptor.departure_times[idx]);
+            result.stop_times.push_back(st);
+        }
+    }
+    return result;
+}
+
+
+std::shared_ptr<const DayIndex> get_day_index(const type::Data& data, uint32_t date, bool disruption_active) {
+    if(data.day_index_days == 0) {
+        return nullptr;
+    }
+    // seuls les prochains jours, qui portent l'essentiel des requêtes, sont indexés
+    const auto& production_date = data.meta->production_date;
+    const auto today_date = data.day_index_today.is_not_a_date() ? boost::gregorian::day_clock::local_day()
+                                                                  : data.day_index_today;
+    const int today = (today_date - production_date.begin()).days();
+    const int first_day = std::max(today, 0);
+    if(int(date) < first_day || int(date) >= first_day + int(data.day_index_days)) {
+        return nullptr;
+    }
+    const auto key = std::make_pair(date, disruption_active);
+    if(auto day_index = data.day_index_cache.get(key)) {
+        return day_index;
+    }
+    // un seul index par jour, sinon les requêtes concurrentes construiraient chacune les mêmes départs
+    std::lock_guard<std::mutex> lock(data.day_index_mutex);
+    if(auto day_index = data.day_index_cache.get(key)) {
+        return day_index;
+    }
+    auto day_index = std::make_shared<const DayIndex>(data, date, disruption_active);
+    data.day_index_cache.insert(key, day_index);
+    return day_index;
+}
+
+
+/// premier départ accessible de la tranche à partir de hour
+static const type::StopTime* first_departure(const DayIndex& day_index, type::idx_t jpp_idx, uint32_t hour,
+                                             const type::VehicleProperties& vehicle_properties) {
+    const auto& departures = day_index.departures(jpp_idx);
+    const auto begin = departures.departure_times.begin();
+    const auto end = departures.departure_times.end();
+    for(auto it = std::lower_bound(begin, end, hour); it != end; ++it) {
+        const type::StopTime* st = departures.stop_times[it - begin];
+        if(st->vehicle_journey->accessible(vehicle_properties)) {
+            return st;
+        }
+    }
+    return nullptr;
+}
+
+
+std::pair<const type::StopTime*, DateTime>
+next_departure(const type::JourneyPatternPoint* jpp, const DateTime dt, const type::Data& data,
+               bool disruption_active, const boost::optional<const std::string>& calendar_id,
+               const type::VehicleProperties& vehicle_properties) {
+    auto fallback = [&]() -> std::pair<const type::StopTime*, DateTime> {
+        return routing::earliest_stop_time(jpp, dt, data, disruption_active, false, calendar_id, vehicle_properties);
+    };
+    if(calendar_id) {
+        return fallback();
+    }
+    const uint32_t date = DateTimeUtils::date(dt);
+    const auto day_index = get_day_index(data, date, disruption_active);
+    if(!day_index || !day_index->indexed(jpp->idx)) {
+        return fallback();
+    }
+    if(const type::StopTime* st = first_departure(*day_index, jpp->idx, DateTimeUtils::hour(dt), vehicle_properties)) {
+        DateTime result = dt;
+        DateTimeUtils::update(result, st->departure_time);
+        return {st, result};
+    }
+    // comme earliest_stop_time, on cherche aussi le lendemain
+    const auto next_day_index = get_day_index(data, date + 1, disruption_active);
+    if(!next_day_index) {
+        return fallback();
+    }
+    if(const type::StopTime* st = first_departure(*next_day_index, jpp->idx, 0, vehicle_properties)) {
+        DateTime result = DateTimeUtils::set(date + 1, 0);
+        DateTimeUtils::update(result, st->departure_time);
+        return {st, result};
+    }
+    return {nullptr, 0};
+}
+
+}}
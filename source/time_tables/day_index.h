@@ -0,0 +1,90 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+#include "type/data.h"
+#include "type/datetime.h"
+#include <memory>
+#include <mutex>
+
+namespace navitia { namespace timetables {
+
+/** Départs d'une journée de service, par journey pattern point
+  *
+  * Pour chaque journey pattern point, les stop times circulant ce jour-là sont rangés
+  * dans un tableau trié par heure de départ : la recherche du prochain départ
+  * est une recherche dichotomique, sans test de validity pattern.
+  * Les départs d'un journey pattern point sont construits à sa première demande, une seule fois,
+  * un index ne coûte donc que pour les journey pattern points interrogés.
+  * Les journey patterns en fréquence ne sont pas indexés.
+  */
+class DayIndex {
+public:
+    struct Departures {
+        std::vector<uint32_t> departure_times;
+        std::vector<const type::StopTime*> stop_times;
+        /// faux pour un journey pattern en fréquence
+        bool indexed = true;
+    };
+
+    DayIndex(const type::Data& data, uint32_t date, bool disruption_active);
+
+    /// départs du journey pattern point, construits au premier appel
+    const Departures& departures(type::idx_t jpp_idx) const;
+
+    bool indexed(type::idx_t jpp_idx) const { return departures(jpp_idx).indexed; }
+
+private:
+    struct Slot {
+        std::once_flag built;
+        std::unique_ptr<const Departures> departures;
+    };
+
+    const type::Data& data;
+    const uint32_t date;
+    const bool disruption_active;
+    std::unique_ptr<Slot[]> slots;
+
+    Departures build(type::idx_t jpp_idx) const;
+};
+
+/// index du jour, construit à la demande, nullptr si le jour est hors de l'horizon indexé
+std::shared_ptr<const DayIndex> get_day_index(const type::Data& data, uint32_t date, bool disruption_active);
+
+/** Prochain départ sur le journey pattern point à partir de dt, comme routing::earliest_stop_time
+  *
+  * Les index des jours sont utilisés quand ils existent, sinon on se rabat sur earliest_stop_time
+  */
+std::pair<const type::StopTime*, DateTime>
+next_departure(const type::JourneyPatternPoint* jpp, const DateTime dt, const type::Data& data,
+               bool disruption_active, const boost::optional<const std::string>& calendar_id,
+               const type::VehicleProperties& vehicle_properties);
+
+}}
@@ -29,49 +29,150 @@ www.navitia.io
 */
 
 #include "get_stop_times.h"
+#include "day_index.h"
 #include "routing/best_stoptime.h"
 #include "type/pb_converter.h"
+#include <algorithm>
 namespace navitia { namespace timetables {
 
 std::vector<datetime_stop_time> get_stop_times(const std::vector<type::idx_t> &journey_pattern_points, const DateTime &dt,
                                                const DateTime &max_dt,
                                                const size_t max_departures, const type::Data & data, bool disruption_active,
                                                boost::optional<const std::string> calendar_id,
-                                               const type::AccessibiliteParams & accessibilite_params) {
-    std::vector<datetime_stop_time> result;
-    auto test_add = true;
+                                               const type::AccessibiliteParams & accessibilite_params,
+                                               std::vector<uint32_t>* circulation_dates) {
+    const auto overlay = data.get_realtime_overlay();
+    // une course de journey pattern en retard au plus de max_delay, ou en avance au plus de max_advance,
+    // passe à l'heure temps réel dans [dt, max_dt] si son horaire théorique est dans [dt - max_delay, max_dt + max_advance]
+    std::vector<DateTime> last_dts(journey_pattern_points.size());
+    int64_t max_advance = 0; // plus grande avance des journey patterns demandés
 
-    // Prochain horaire où l’on demandera le prochain départ : on s’en sert pour ne pas obtenir plusieurs fois le même stop_time
-    // Initialement, c’est l’heure demandée
-    std::map<type::idx_t, DateTime> next_requested_datetime;
-    for(auto jpp_idx : journey_pattern_points){
-        next_requested_datetime[jpp_idx] = dt;
-    }
+    // Fusion des départs de chaque journey pattern point : le tas contient le prochain départ de chaque jpp,
+    // on traite le plus tôt et on ne cherche le suivant que sur son jpp.
+    // Le tas est ordonné par horaire théorique, les départs en sortent donc triés par horaire théorique.
+    // Une course en fréquence a son propre curseur qui génère ses départs de headway en headway,
+    // le curseur du jpp reprend après la fin de la plage de la fréquence.
+    struct Cursor {
+        DateTime dt; // horaire temps réel
+        DateTime theoretical_dt;
+        int32_t delay;
+        const type::StopTime* st;
+        const type::JourneyPatternPoint* jpp;
+        size_t order; // rang du jpp dans la requête, pour départager les départs simultanés
+        bool frequency_block; // curseur d'une course en fréquence déjà commencée
+        DateTime block_end; // dernier départ théorique possible de la course en fréquence
+    };
+    auto later = [](const Cursor& c1, const Cursor& c2) {
+        return c1.theoretical_dt > c2.theoretical_dt || (c1.theoretical_dt == c2.theoretical_dt && c1.order > c2.order);
+    };
+    std::vector<Cursor> heap;
+    heap.reserve(journey_pattern_points.size());
 
-    while(test_add && result.size() < max_departures) {
-        test_add = false;
-        for(auto jpp_idx : journey_pattern_points) {
-            const type::JourneyPatternPoint* jpp = data.pt_data->journey_pattern_points[jpp_idx];
-            if(!jpp->stop_point->accessible(accessibilite_params.properties)) {
-                continue;
+    auto push = [&](const Cursor& cursor) {
+        if(cursor.theoretical_dt <= last_dts[cursor.order]) {
+            heap.push_back(cursor);
+            std::push_heap(heap.begin(), heap.end(), later);
+        }
+    };
+
+    auto push_next = [&](const type::JourneyPatternPoint* jpp, size_t order, DateTime from) {
+        while(true) {
+            auto st = next_departure(jpp, from, data, disruption_active, calendar_id, accessibilite_params.vehicle_properties);
+            if(st.first == nullptr || st.second > last_dts[order]) {
+                return;
             }
-            auto st = routing::earliest_stop_time(jpp, next_requested_datetime[jpp_idx], data, disruption_active, false, calendar_id, accessibilite_params.vehicle_properties);
-            if(st.first != nullptr) {
-                DateTime dt_temp = st.second;
-                if(dt_temp <= max_dt && result.size() < max_departures) {
-                    result.push_back(std::make_pair(dt_temp, st.first));
-                    test_add = true;
-                    // Le prochain horaire observé doit être au minimum une seconde après
-                    if(st.first->is_frequency()) {
-                        DateTimeUtils::update(dt_temp, st.first->end_time);
-                    }
-                    next_requested_datetime[jpp_idx] = dt_temp + 1;
+            const type::TripUpdate* update = overlay->empty() ? nullptr :
+                overlay->get(st.first->vehicle_journey->idx, type::circulation_date(st.second, st.first));
+            if(update != nullptr && update->skips(jpp->order)) {
+                // course supprimée ou arrêt non desservi :
+                // on passe à la course suivante, ou après la plage de la fréquence
+                from = st.second;
+                if(st.first->is_frequency()) {
+                    DateTimeUtils::update(from, st.first->end_time);
                 }
+                ++from;
+                continue;
             }
+            const int32_t delay = update != nullptr ? update->delay : 0;
+            push({type::apply_delay(st.second, delay), st.second, delay, st.first, jpp, order, false, 0});
+            return;
         }
-     }
-    std::sort(result.begin(), result.end(),[](datetime_stop_time dst1, datetime_stop_time dst2) {return dst1.first < dst2.first;});
+    };
 
+    for(size_t order = 0; order < journey_pattern_points.size(); ++order) {
+        const type::JourneyPatternPoint* jpp = data.pt_data->journey_pattern_points[journey_pattern_points[order]];
+        if(!jpp->stop_point->accessible(accessibilite_params.properties)) {
+            continue;
+        }
+        const int64_t jp_delay = overlay->max_delay(jpp->journey_pattern->idx);
+        const int64_t jp_advance = overlay->max_advance(jpp->journey_pattern->idx);
+        max_advance = std::max(max_advance, jp_advance);
+        last_dts[order] = DateTime(std::min<int64_t>(int64_t(max_dt) + jp_advance, DateTimeUtils::inf));
+        push_next(jpp, order, DateTime(std::max<int64_t>(int64_t(dt) - jp_delay, 0)));
+    }
+
+    // Les max_departures premiers départs à l'heure temps réel, dans un tas dont le sommet est le plus tardif.
+    // Un départ est identifié par son rang de sortie du tas des curseurs pour départager les égalités,
+    // sans retard c'est l'ordre des horaires théoriques.
+    typedef std::pair<DateTime, size_t> ranked_departure;
+    std::vector<ranked_departure> best;
+    std::vector<const type::StopTime*> stop_times;
+    std::vector<uint32_t> dates;
+    while(!heap.empty()) {
+        // les départs restants passent au plus tôt à l'horaire théorique du sommet moins la plus grande avance
+        // de leurs journey patterns :
+        // s'ils ne peuvent plus passer avant le plus tardif des départs gardés, on a fini
+        if(best.size() >= max_departures
+                && (best.empty() || int64_t(heap.front().theoretical_dt) - max_advance >= int64_t(best.front().first))) {
+            break;
+        }
+        std::pop_heap(heap.begin(), heap.end(), later);
+        const Cursor next = heap.back();
+        heap.pop_back();
+
+        if(next.dt >= dt && next.dt <= max_dt) {
+            best.push_back({next.dt, stop_times.size()});
+            std::push_heap(best.begin(), best.end());
+            stop_times.push_back(next.st);
+            dates.push_back(type::circulation_date(next.theoretical_dt, next.st));
+            if(best.size() > max_departures) {
+                std::pop_heap(best.begin(), best.end());
+                best.pop_back();
+            }
+        }
+
+        if(!next.st->is_frequency()) {
+            // Le prochain horaire observé doit être au minimum une seconde après
+            push_next(next.jpp, next.order, next.theoretical_dt + 1);
+            continue;
+        }
+        DateTime block_end = next.block_end;
+        if(!next.frequency_block) {
+            // premier départ de la course : le jpp reprend après sa plage
+            block_end = next.theoretical_dt;
+            DateTimeUtils::update(block_end, next.st->end_time);
+            push_next(next.jpp, next.order, block_end + 1);
+        }
+        const DateTime following = next.theoretical_dt + next.st->headway_secs;
+        if(following <= block_end) {
+            push({type::apply_delay(following, next.delay), following, next.delay,
+                  next.st, next.jpp, next.order, true, block_end});
+        }
+    }
+
+    std::sort(best.begin(), best.end());
+    std::vector<datetime_stop_time> result;
+    result.reserve(best.size());
+    if(circulation_dates != nullptr) {
+        circulation_dates->clear();
+        circulation_dates->reserve(best.size());
+    }
+    for(const ranked_departure& departure : best) {
+        result.push_back(std::make_pair(departure.first, stop_times[departure.second]));
+        if(circulation_dates != nullptr) {
+            circulation_dates->push_back(dates[departure.second]);
+        }
+    }
     return result;
 }
 
@@ -45,12 +45,15 @@ typedef std::pair<DateTime, const type::StopTime*> datetime_stop_time;
  * @param nb_departures: max number of departure
  * @param data: data container
  * @param accessibilite_params: accebility criteria to restrict the stop times
+ * @param circulation_dates: if given, filled with the circulation date of each departure's trip,
+ *        to look up its realtime update
  * @return: a list of pair <datetime, departure st.idx>. The list is sorted on the datetimes.
  */
 std::vector<datetime_stop_time> get_stop_times(const std::vector<type::idx_t> &journey_pattern_points, const DateTime &dt,
                                    const DateTime &max_dt, const size_t max_departures, const type::Data & data, bool disruption_active,
                                    boost::optional<const std::string> calendar_id = {},
-                                   const type::AccessibiliteParams & accessibilite_params = type::AccessibiliteParams());
+                                   const type::AccessibiliteParams & accessibilite_params = type::AccessibiliteParams(),
+                                   std::vector<uint32_t>* circulation_dates = nullptr);
 
 
 
@@ -41,6 +41,35 @@ namespace pt = boost::posix_time;
 
 namespace navitia { namespace timetables {
 
+static void fill_passage(pbnavitia::Passage* passage, const datetime_stop_time& dt_stop_time,
+                         const type::Data& data, const int depth, const pt::ptime& now,
+                         const pt::time_period& action_period, const bool show_codes) {
+    auto departure_date = navitia::iso_string(dt_stop_time.first, data);
+    auto arrival_date = navitia::iso_string(dt_stop_time.first, data);
+    passage->mutable_stop_date_time()->set_departure_date_time(departure_date);
+    passage->mutable_stop_date_time()->set_arrival_date_time(arrival_date);
+    const type::JourneyPatternPoint* jpp = dt_stop_time.second->journey_pattern_point;
+    fill_pb_object(jpp->stop_point, data, passage->mutable_stop_point(),
+            depth, now, action_period);
+    const type::VehicleJourney* vj = dt_stop_time.second->vehicle_journey;
+    const type::JourneyPattern* jp = vj->journey_pattern;
+    const type::Route* route = jp->route;
+    const type::Line* line = route->line;
+    const type::PhysicalMode* physical_mode = jp->physical_mode;
+    auto m_vj = passage->mutable_vehicle_journey();
+    auto m_route = m_vj->mutable_route();
+    auto m_physical_mode = m_vj->mutable_journey_pattern()->mutable_physical_mode();
+    fill_pb_object(vj, data, m_vj, 0, now, action_period, show_codes);
+    fill_pb_object(route, data, m_route, 0, now, action_period, show_codes);
+    fill_pb_object(line, data, m_route->mutable_line(), 0, now, action_period, show_codes);
+    fill_pb_object(physical_mode, data, m_physical_mode, 0, now, action_period);
+}
+
+/// aucun départ ne se fait du dernier arrêt d'un journey pattern
+static bool is_terminus(const type::JourneyPatternPoint* jpp) {
+    return jpp == jpp->journey_pattern->journey_pattern_point_list.back();
+}
+
 template<typename Visitor>
 pbnavitia::Response
 next_passages(const std::string &request,
@@ -56,8 +85,9 @@ next_passages(const std::string &request,
         return handler.pb_response;
     }
 
-    std::remove_if(handler.journey_pattern_points.begin(),
-                   handler.journey_pattern_points.end(), vis.predicate);
+    handler.journey_pattern_points.erase(std::remove_if(handler.journey_pattern_points.begin(),
+                                                        handler.journey_pattern_points.end(), vis.predicate),
+                                         handler.journey_pattern_points.end());
 
     auto passages_dt_st = get_stop_times(handler.journey_pattern_points,
                             handler.date_time, handler.max_datetime,
@@ -74,25 +104,7 @@ next_passages(const std::string &request,
             passage = handler.pb_response.add_next_arrivals();
         else
             passage = handler.pb_response.add_next_departures();
-        auto departure_date = navitia::iso_string(dt_stop_time.first, data);
-        auto arrival_date = navitia::iso_string(dt_stop_time.first, data);
-        passage->mutable_stop_date_time()->set_departure_date_time(departure_date);
-        passage->mutable_stop_date_time()->set_arrival_date_time(arrival_date);
-        const type::JourneyPatternPoint* jpp = dt_stop_time.second->journey_pattern_point;
-        fill_pb_object(jpp->stop_point, data, passage->mutable_stop_point(),
-                depth, now, action_period);
-        const type::VehicleJourney* vj = dt_stop_time.second->vehicle_journey;
-        const type::JourneyPattern* jp = vj->journey_pattern;
-        const type::Route* route = jp->route;
-        const type::Line* line = route->line;
-        const type::PhysicalMode* physical_mode = jp->physical_mode;
-        auto m_vj = passage->mutable_vehicle_journey();
-        auto m_route = m_vj->mutable_route();
-        auto m_physical_mode = m_vj->mutable_journey_pattern()->mutable_physical_mode();
-        fill_pb_object(vj, data, m_vj, 0, now, action_period, show_codes);
-        fill_pb_object(route, data, m_route, 0, now, action_period, show_codes);
-        fill_pb_object(line, data, m_route->mutable_line(), 0, now, action_period, show_codes);
-        fill_pb_object(physical_mode, data, m_physical_mode, 0, now, action_period);
+        fill_passage(passage, dt_stop_time, data, depth, now, action_period, show_codes);
     }
     auto pagination = handler.pb_response.mutable_pagination();
     pagination->set_totalresult(total_result);
@@ -115,9 +127,7 @@ pbnavitia::Response next_departures(const std::string &request,
             type::Data &data;
             predicate_t(type::Data& data) : data(data){}
             bool operator()(const type::idx_t jppidx) const {
-                auto jpp = data.pt_data->journey_pattern_points[jppidx];
-                auto last_jpp = jpp->journey_pattern->journey_pattern_point_list.back();
-                return jpp == last_jpp;
+                return is_terminus(data.pt_data->journey_pattern_points[jppidx]);
             }
         };
         std::string api_str;
@@ -159,4 +169,62 @@ pbnavitia::Response next_arrivals(const std::string &request,
 }
 
 
+/// journey pattern points d'où partent des courses, résolus par les maps des uris
+static bool departure_journey_pattern_points(const std::string& uri, const type::Data& data,
+                                             std::vector<type::idx_t>& result) {
+    auto add = [&](const type::StopPoint* stop_point) {
+        for(const type::JourneyPatternPoint* jpp : stop_point->journey_pattern_point_list) {
+            if(!is_terminus(jpp)) {
+                result.push_back(jpp->idx);
+            }
+        }
+    };
+    auto stop_area = data.pt_data->stop_areas_map.find(uri);
+    if(stop_area != data.pt_data->stop_areas_map.end()) {
+        for(const type::StopPoint* stop_point : stop_area->second->stop_point_list) {
+            add(stop_point);
+        }
+        return true;
+    }
+    auto stop_point = data.pt_data->stop_points_map.find(uri);
+    if(stop_point != data.pt_data->stop_points_map.end()) {
+        add(stop_point->second);
+        return true;
+    }
+    return false;
+}
+
+
+pbnavitia::Response next_departures_batch(const std::vector<std::string>& stop_uris,
+        const std::string &str_dt, uint32_t duration, uint32_t nb_stoptimes,
+        const int depth, const type::AccessibiliteParams & accessibilite_params,
+        const type::Data & data, bool disruption_active, const bool show_codes) {
+    RequestHandle handler(str_dt, duration, data);
+    if(handler.pb_response.has_error()) {
+        return handler.pb_response;
+    }
+    auto now = pt::second_clock::local_time();
+    pt::time_period action_period(navitia::to_posix_time(handler.date_time, data),
+                                  navitia::to_posix_time(handler.max_datetime, data));
+    std::vector<type::idx_t> journey_pattern_points;
+    for(const std::string& uri : stop_uris) {
+        auto* stop = handler.pb_response.add_stops_next_departures();
+        stop->set_uri(uri);
+        journey_pattern_points.clear();
+        if(!departure_journey_pattern_points(uri, data, journey_pattern_points)) {
+            fill_pb_error(pbnavitia::Error::bad_filter, "unknown stop area or stop point " + uri,
+                          stop->mutable_error());
+            continue;
+        }
+        const auto passages_dt_st = get_stop_times(journey_pattern_points,
+                handler.date_time, handler.max_datetime,
+                nb_stoptimes, data, disruption_active, {}, accessibilite_params);
+        for(const auto& dt_stop_time : passages_dt_st) {
+            fill_passage(stop->add_next_departures(), dt_stop_time, data, depth, now, action_period, show_codes);
+        }
+    }
+    return handler.pb_response;
+}
+
+
 } }
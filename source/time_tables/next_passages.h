@@ -46,4 +46,14 @@ pbnavitia::Response next_arrivals(const std::string &request,
         type::Data & data, bool disruption_active, uint32_t count, uint32_t start_page,
         const bool show_codes);
 
+/** Prochains départs de chaque zone d'arrêt ou point d'arrêt de stop_uris, nb_stoptimes par arrêt
+  *
+  * Les arrêts sont résolus directement par leur uri, sans passer par un filtre ptref.
+  * Les départs sont regroupés par arrêt dans stops_next_departures, dans l'ordre de stop_uris.
+  */
+pbnavitia::Response next_departures_batch(const std::vector<std::string>& stop_uris,
+        const std::string &str_dt, uint32_t duration, uint32_t nb_stoptimes,
+        const int depth, const type::AccessibiliteParams & accessibilite_params,
+        const type::Data & data, bool disruption_active, const bool show_codes);
+
 }}
@@ -34,11 +34,8 @@ www.navitia.io
 
 namespace navitia { namespace timetables {
 
-RequestHandle::RequestHandle(const std::string& /*api*/, const std::string &request,
-                             const std::vector<std::string>& forbidden_uris,
-                             const std::string &str_dt, uint32_t duration,
-                             const type::Data &data) :
-    date_time(DateTimeUtils::inf), max_datetime(DateTimeUtils::inf){
+RequestHandle::RequestHandle(const std::string &str_dt, uint32_t duration, const type::Data &data) :
+    date_time(DateTimeUtils::inf), max_datetime(DateTimeUtils::inf), total_result(0){
     try {
         auto ptime = boost::posix_time::from_iso_string(str_dt);
         if( !data.meta->production_date.contains(ptime.date()) ) {
@@ -50,17 +47,31 @@ RequestHandle::RequestHandle(const std::string& /*api*/, const std::string &requ
         if(! pb_response.has_error()){
             date_time = DateTimeUtils::set((ptime.date() - data.meta->production_date.begin()).days(), ptime.time_of_day().total_seconds());
             max_datetime = date_time + duration;
-            const auto jpp_t = type::Type_e::JourneyPatternPoint;
-            journey_pattern_points = ptref::make_query(jpp_t, request, forbidden_uris, data);
-            total_result = journey_pattern_points.size();
         }
+    } catch(...) {
+        fill_pb_error(pbnavitia::Error::unable_to_parse, "Unable to parse Datetime",pb_response.mutable_error());
+    }
+}
+
+RequestHandle::RequestHandle(const std::string& /*api*/, const std::string &request,
+                             const std::vector<std::string>& forbidden_uris,
+                             const std::string &str_dt, uint32_t duration,
+                             const type::Data &data) :
+    RequestHandle(str_dt, duration, data){
+    if(pb_response.has_error()){
+        return;
+    }
+    try {
+        const auto jpp_t = type::Type_e::JourneyPatternPoint;
+        journey_pattern_points = ptref::make_query(jpp_t, request, forbidden_uris, data);
+        total_result = journey_pattern_points.size();
     } catch(const ptref::parsing_error &parse_error) {
         fill_pb_error(pbnavitia::Error::unable_to_parse, "Unable to parse Datetime" + parse_error.more,pb_response.mutable_error());
     } catch(const ptref::ptref_error &ptref_error){
         fill_pb_error(pbnavitia::Error::bad_filter, "ptref : "  + ptref_error.more,pb_response.mutable_error());
     } catch(...) {
         fill_pb_error(pbnavitia::Error::unable_to_parse, "Unable to parse Datetime",pb_response.mutable_error());
-  }
+    }
 }
 
 }}
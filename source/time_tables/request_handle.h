@@ -48,6 +48,9 @@ struct RequestHandle {
                   const std::vector<std::string>& forbidden_uris,
                   const std::string &change_time, uint32_t duration,
                   const type::Data & data);
+
+    /// ne valide que la date et la durée, sans chercher de journey_pattern_points
+    RequestHandle(const std::string &change_time, uint32_t duration, const type::Data & data);
 };
 }
 
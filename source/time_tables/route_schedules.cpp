@@ -36,6 +36,8 @@ www.navitia.io
 #include "utils/paginate.h"
 #include "type/datetime.h"
 #include "routing/best_stoptime.h"
+#include <unordered_map>
+#include <unordered_set>
 
 namespace pt = boost::posix_time;
 
@@ -57,20 +59,30 @@ get_all_stop_times(const vector_idx &journey_patterns,
     }
 
     //On fait un best_stop_time sur ces journey_pattern points
+    std::vector<uint32_t> circulation_dates;
     auto first_dt_st = get_stop_times(first_journey_pattern_points,
                                       dateTime, max_datetime,
-                                      std::numeric_limits<int>::max(), d, disruption_active);
+                                      std::numeric_limits<int>::max(), d, disruption_active,
+                                      {}, type::AccessibiliteParams(), &circulation_dates);
+    const auto overlay = d.get_realtime_overlay();
 
     //On va chercher tous les prochains horaires
-    for(auto ho : first_dt_st) {
+    result.reserve(first_dt_st.size());
+    for(size_t i = 0; i < first_dt_st.size(); ++i) {
+        const auto& ho = first_dt_st[i];
+        const type::VehicleJourney* vj = ho.second->vehicle_journey;
+        const type::TripUpdate* update = overlay->get(vj->idx, circulation_dates[i]);
         result.push_back(std::vector<datetime_stop_time>());
-        DateTime dt = ho.first;
-        for(const type::StopTime* stop_time : ho.second->vehicle_journey->stop_time_list) {
-            if(!stop_time->is_frequency()) {
-                DateTimeUtils::update(dt, stop_time->departure_time);
-            } else {
-                DateTimeUtils::update(dt, routing::f_departure_time(dt, stop_time));
+        result.back().reserve(vj->stop_time_list.size());
+        // les horaires des arrêts suivent les temps de parcours de la course : ils gardent ainsi
+        // le retard temps réel du départ, et pour une fréquence le départ choisi
+        for(const type::StopTime* stop_time : vj->stop_time_list) {
+            if(update != nullptr && update->skips(stop_time->journey_pattern_point->order)) {
+                // arrêt non desservi : la case reste vide, comme celles des arrêts hors de la course
+                result.back().push_back(datetime_stop_time());
+                continue;
             }
+            const DateTime dt = ho.first + stop_time->departure_time - ho.second->departure_time;
             result.back().push_back(std::make_pair(dt, stop_time));
         }
     }
@@ -78,27 +90,38 @@ get_all_stop_times(const vector_idx &journey_patterns,
 }
 
 
-std::vector<std::vector<datetime_stop_time> >
+/// Matrice des horaires d'une grille : une ligne par arrêt du thermomètre, une colonne par course
+struct ScheduleMatrix {
+    size_t nb_columns;
+    std::vector<datetime_stop_time> cells; // rangées ligne par ligne
+
+    ScheduleMatrix(size_t nb_rows, size_t nb_columns) :
+        nb_columns(nb_columns), cells(nb_rows * nb_columns) {}
+
+    datetime_stop_time& operator()(size_t row, size_t column) { return cells[row * nb_columns + column]; }
+    const datetime_stop_time& operator()(size_t row, size_t column) const { return cells[row * nb_columns + column]; }
+};
+
+
+ScheduleMatrix
 make_matrice(const std::vector<std::vector<datetime_stop_time> >& stop_times,
              const Thermometer &thermometer, const type::Data &) {
-    std::vector<std::vector<datetime_stop_time> > result;
-    //On initilise le tableau vide
-    for(unsigned int i=0; i<thermometer.get_thermometer().size(); ++i) {
-        result.push_back(std::vector<datetime_stop_time>());
-        result.back().resize(stop_times.size());
-    }
+    ScheduleMatrix result(thermometer.get_thermometer().size(), stop_times.size());
+    //Les courses d'un même journey pattern ont les mêmes positions dans le thermomètre
+    std::unordered_map<type::idx_t, std::vector<uint32_t>> orders_by_jp;
 
     //On remplit le tableau
-    int y=0;
-    for(std::vector<datetime_stop_time> vec : stop_times) {
-        auto jpp = *vec.front().second->vehicle_journey->journey_pattern;
-        std::vector<uint32_t> orders = thermometer.match_journey_pattern(jpp);
-        int order = 0;
-        for(datetime_stop_time dt_stop_time : vec) {
-            result[orders[order]][y] = dt_stop_time;
-            ++order;
+    for(size_t y = 0; y < stop_times.size(); ++y) {
+        const std::vector<datetime_stop_time>& vec = stop_times[y];
+        const type::JourneyPattern* jp = vec.front().second->vehicle_journey->journey_pattern;
+        auto it = orders_by_jp.find(jp->idx);
+        if(it == orders_by_jp.end()) {
+            it = orders_by_jp.insert({jp->idx, thermometer.match_journey_pattern(*jp)}).first;
+        }
+        const std::vector<uint32_t>& orders = it->second;
+        for(size_t order = 0; order < vec.size(); ++order) {
+            result(orders[order], y) = vec[order];
         }
-        ++y;
     }
 
     return result;
@@ -106,15 +129,14 @@ make_matrice(const std::vector<std::vector<datetime_stop_time> >& stop_times,
 
 
 std::vector<type::VehicleJourney*>
-get_vehicle_journey(const std::vector<std::vector<datetime_stop_time> >& stop_times){
+get_vehicle_journey(const std::vector<std::vector<datetime_stop_time> >& stop_times, const type::Data&){
     std::vector<type::VehicleJourney*> result;
-    for(const std::vector<datetime_stop_time> vec : stop_times){
+    // seules les courses de la grille sont marquées, pas toutes celles des données
+    std::unordered_set<type::idx_t> seen;
+    seen.reserve(stop_times.size());
+    for(const std::vector<datetime_stop_time>& vec : stop_times){
         type::VehicleJourney* vj = vec.front().second->vehicle_journey;
-        auto it = std::find_if(result.begin(), result.end(),
-                               [vj](type::VehicleJourney* vj1){
-                                return (vj->idx == vj1->idx);
-                        });
-        if(it == result.end()){
+        if(seen.insert(vj->idx).second){
             result.push_back(vj);
         }
     }
@@ -122,6 +144,26 @@ get_vehicle_journey(const std::vector<std::vector<datetime_stop_time> >& stop_ti
 }
 
 
+std::shared_ptr<const Thermometer>
+get_thermometer(const vector_idx& journey_patterns, type::Data& d) {
+    if(auto cached = d.thermometer_cache.get(journey_patterns)) {
+        return cached;
+    }
+    std::vector<vector_idx> stop_points;
+    for(auto jp_idx : journey_patterns) {
+        auto jp = d.pt_data->journey_patterns[jp_idx];
+        stop_points.push_back(vector_idx());
+        for(auto jpp : jp->journey_pattern_point_list) {
+            stop_points.back().push_back(jpp->stop_point->idx);
+        }
+    }
+    auto thermometer = std::make_shared<Thermometer>();
+    thermometer->generate_thermometer(stop_points);
+    d.thermometer_cache.insert(journey_patterns, thermometer);
+    return thermometer;
+}
+
+
 pbnavitia::Response
 route_schedule(const std::string& filter,
                const std::vector<std::string>& forbidden_uris,
@@ -138,29 +180,27 @@ route_schedule(const std::string& filter,
     auto pt_datetime = to_posix_time(handler.date_time, d);
     auto pt_max_datetime = to_posix_time(handler.max_datetime, d);
     pt::time_period action_period(pt_datetime, pt_max_datetime);
-    Thermometer thermometer;
     auto routes_idx = ptref::make_query(type::Type_e::Route, filter, forbidden_uris, d);
     size_t total_result = routes_idx.size();
     routes_idx = paginate(routes_idx, count, start_page);
+    //Les journey patterns du filtre, regroupés par route : une seule requête ptref pour toutes les routes
+    std::map<type::idx_t, vector_idx> jps_by_route;
+    if(!routes_idx.empty()) {
+        for(auto jp_idx : ptref::make_query(type::Type_e::JourneyPattern, filter, forbidden_uris, d)) {
+            jps_by_route[d.pt_data->journey_patterns[jp_idx]->route->idx].push_back(jp_idx);
+        }
+    }
     for(type::idx_t route_idx : routes_idx) {
         auto route = d.pt_data->routes[route_idx];
-        auto jps =  ptref::make_query(type::Type_e::JourneyPattern, filter+" and route.uri="+route->uri, forbidden_uris, d);
+        const vector_idx& jps = jps_by_route[route_idx];
         //On récupère les stop_times
         auto stop_times = get_all_stop_times(jps, handler.date_time,
                                              handler.max_datetime, d, disruption_active);
-        std::vector<vector_idx> stop_points;
-        for(auto jp_idx : jps) {
-            auto jp = d.pt_data->journey_patterns[jp_idx];
-            stop_points.push_back(vector_idx());
-            for(auto jpp : jp->journey_pattern_point_list) {
-                stop_points.back().push_back(jpp->stop_point->idx);
-            }
-        }
-        thermometer.generate_thermometer(stop_points);
+        const Thermometer& thermometer = *get_thermometer(jps, d);
         //On génère la matrice
-        auto  matrice = make_matrice(stop_times, thermometer, d);
+        const auto matrice = make_matrice(stop_times, thermometer, d);
          //On récupère les vehicleJourny de manière unique
-        auto vehicle_journy_list = get_vehicle_journey(stop_times);
+        auto vehicle_journy_list = get_vehicle_journey(stop_times, d);
         auto schedule = handler.pb_response.add_route_schedules();
         pbnavitia::Table *table = schedule->mutable_table();
         auto m_pt_display_informations = schedule->mutable_pt_display_informations();
@@ -174,15 +214,20 @@ route_schedule(const std::string& filter,
             fill_pb_object(vj, d, add_info_vehicle_journey, 0, now, action_period);
         }
 
-        for(unsigned int i=0; i < thermometer.get_thermometer().size(); ++i) {
-            type::idx_t spidx=thermometer.get_thermometer()[i];
+        const vector_idx& thermometer_stop_points = thermometer.get_thermometer();
+        table->mutable_rows()->Reserve(thermometer_stop_points.size());
+        for(unsigned int i=0; i < thermometer_stop_points.size(); ++i) {
+            type::idx_t spidx=thermometer_stop_points[i];
             const type::StopPoint* sp = d.pt_data->stop_points[spidx];
             //version v1
             pbnavitia::RouteScheduleRow* row = table->add_rows();
             fill_pb_object(sp, d, row->mutable_stop_point(), max_depth,
                            now, action_period, show_codes);
+            if(interface_version == 1) {
+                row->mutable_date_times()->Reserve(stop_times.size());
+            }
             for(unsigned int j=0; j<stop_times.size(); ++j) {
-                datetime_stop_time dt_stop_time  = matrice[i][j];
+                const datetime_stop_time& dt_stop_time  = matrice(i, j);
                 if(interface_version == 1) {
                     auto pb_dt = row->add_date_times();
                     fill_pb_object(dt_stop_time.second, d, pb_dt, max_depth,
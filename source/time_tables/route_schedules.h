@@ -32,6 +32,7 @@ www.navitia.io
 #include "type/type.h"
 #include "routing/routing.h"
 #include "get_stop_times.h"
+#include "thermometer.h"
 #include "type/pb_converter.h"
 
 namespace navitia { namespace timetables {
@@ -39,6 +40,14 @@ namespace navitia { namespace timetables {
 typedef std::vector<std::string> vector_string;
 typedef std::pair<DateTime, const type::StopTime*> vector_date_time;
 
+/// horaires des courses qui partent entre dateTime et max_datetime, une case vide pour chaque arrêt non desservi
+std::vector<std::vector<datetime_stop_time> >
+get_all_stop_times(const vector_idx &journey_patterns, const DateTime &dateTime,
+                   const DateTime &max_datetime, type::Data &d, bool disruption_active);
+
+/// thermomètre des journey patterns, calculé une fois par génération des données
+std::shared_ptr<const Thermometer> get_thermometer(const vector_idx& journey_patterns, type::Data& d);
+
 pbnavitia::Response route_schedule(const std::string & line_externalcode,
         const std::vector<std::string>& forbidden_uris,
         const std::string &str_dt, uint32_t duration, uint32_t interface_version,
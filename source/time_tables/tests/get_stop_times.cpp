@@ -32,6 +32,7 @@ www.navitia.io
 #define BOOST_TEST_MODULE test_ed
 #include <boost/test/unit_test.hpp>
 #include "time_tables/get_stop_times.h"
+#include "time_tables/day_index.h"
 #include "ed/build_helper.h"
 using namespace navitia::timetables;
 
@@ -48,3 +49,213 @@ BOOST_AUTO_TEST_CASE(test1){
     BOOST_REQUIRE_EQUAL(result.size(), 1);
 
 }
+
+/// the first departures are the earliest of all the journey pattern points, in order
+BOOST_AUTO_TEST_CASE(earliest_departures_merged){
+    ed::builder b("20120614");
+    b.vj("A")("stop1", 9000, 9050)("stop2", 9100, 9150);
+    b.vj("B")("stop1", 8000, 8050)("stop3", 8100, 8150);
+    b.vj("B")("stop1", 8500, 8550)("stop3", 8600, 8650);
+    b.data->pt_data->index();
+    b.data->build_raptor();
+
+    std::vector<navitia::type::idx_t> rps;
+    for(auto jpp : b.data->pt_data->journey_pattern_points) {
+        if(jpp->stop_point->uri == "stop1")
+            rps.push_back(jpp->idx);
+    }
+    BOOST_REQUIRE_EQUAL(rps.size(), 2);
+    auto result = get_stop_times(rps, navitia::DateTimeUtils::min, navitia::DateTimeUtils::inf, 2, *b.data, false);
+    BOOST_REQUIRE_EQUAL(result.size(), 2);
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::hour(result[0].first), 8050);
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::hour(result[1].first), 8550);
+
+    result = get_stop_times(rps, navitia::DateTimeUtils::min, navitia::DateTimeUtils::set(0, 9000), 10, *b.data, false);
+    BOOST_CHECK_EQUAL(result.size(), 2);
+}
+
+/// the index of a day only has the departures running this day, sorted
+BOOST_AUTO_TEST_CASE(day_index){
+    ed::builder b("20120614");
+    b.vj("A", "11", "", true)("stop1", 9000, 9050)("stop2", 9100, 9150);
+    b.vj("A", "10", "", true)("stop1", 8000, 8050)("stop2", 8100, 8150);
+    b.vj("A", "11", "", true)("stop1", 8500, 8550)("stop2", 8600, 8650);
+    b.data->pt_data->index();
+    b.data->build_raptor();
+
+    navitia::type::idx_t jpp_idx = navitia::type::invalid_idx;
+    for(auto jpp : b.data->pt_data->journey_pattern_points) {
+        if(jpp->stop_point->uri == "stop1")
+            jpp_idx = jpp->idx;
+    }
+    BOOST_REQUIRE(jpp_idx != navitia::type::invalid_idx);
+
+    DayIndex first_day(*b.data, 0, false);
+    BOOST_REQUIRE(first_day.indexed(jpp_idx));
+    BOOST_CHECK((first_day.departures(jpp_idx).departure_times == std::vector<uint32_t>{8550, 9050}));
+    //the departures are built once
+    BOOST_CHECK_EQUAL(&first_day.departures(jpp_idx), &first_day.departures(jpp_idx));
+
+    DayIndex second_day(*b.data, 1, false);
+    BOOST_CHECK((second_day.departures(jpp_idx).departure_times == std::vector<uint32_t>{8050, 8550, 9050}));
+}
+
+/// the departures found through the day indexes are the ones found by earliest_stop_time
+BOOST_AUTO_TEST_CASE(day_index_departures){
+    ed::builder b("20120614");
+    b.vj("A", "11", "", true)("stop1", 9000, 9050)("stop2", 9100, 9150);
+    b.vj("A", "10", "", true)("stop1", 8000, 8050)("stop2", 8100, 8150);
+    b.vj("A", "11", "", true)("stop1", 8500, 8550)("stop2", 8600, 8650);
+    b.vj("B", "111", "", true)("stop1", 7000, 7050)("stop3", 7100, 7150);
+    b.data->pt_data->index();
+    b.data->build_raptor();
+
+    std::vector<navitia::type::idx_t> rps;
+    for(auto jpp : b.data->pt_data->journey_pattern_points) {
+        if(jpp->stop_point->uri == "stop1")
+            rps.push_back(jpp->idx);
+    }
+    auto departures = [&](navitia::DateTime dt, size_t max_departures) {
+        return get_stop_times(rps, dt, navitia::DateTimeUtils::inf, max_departures, *b.data, false);
+    };
+    const std::vector<std::pair<navitia::DateTime, size_t>> requests = {
+        {navitia::DateTimeUtils::set(0, 0), 10},
+        {navitia::DateTimeUtils::set(0, 8500), 2},
+        //after the last departure of the day: the next ones are found the day after
+        {navitia::DateTimeUtils::set(0, 9500), 3},
+        //the day after is out of the indexed days
+        {navitia::DateTimeUtils::set(1, 9500), 3},
+    };
+    std::vector<std::vector<datetime_stop_time>> expected;
+    for(const auto& request : requests) {
+        expected.push_back(departures(request.first, request.second));
+    }
+    BOOST_CHECK_EQUAL(expected[2].size(), 3);
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::date(expected[2][0].first), 1);
+
+    b.data->day_index_days = 2;
+    b.data->day_index_cache.set_max_weight(4);
+    b.data->day_index_today = boost::gregorian::date(2012, 6, 14);
+    for(size_t i = 0; i < requests.size(); ++i) {
+        BOOST_CHECK(departures(requests[i].first, requests[i].second) == expected[i]);
+    }
+    //both indexed days were used
+    BOOST_CHECK_EQUAL(b.data->day_index_cache.size(), 2);
+
+    //the indexed days follow today
+    b.data->day_index_today = boost::gregorian::date(2012, 6, 15);
+    BOOST_CHECK(!get_day_index(*b.data, 0, false));
+    BOOST_CHECK(get_day_index(*b.data, 2, false));
+}
+
+/// the trips in frequency give all their departures, from headway to headway
+BOOST_AUTO_TEST_CASE(frequency_departures){
+    ed::builder b("20120614");
+    b.vj("A")("stop1", 0, 0)("stop2", 600, 600).frequency(8*3600, 9*3600, 600);
+    b.data->pt_data->index();
+    b.data->build_raptor();
+
+    std::vector<navitia::type::idx_t> rps;
+    for(auto jpp : b.data->pt_data->journey_pattern_points) {
+        if(jpp->stop_point->uri == "stop1")
+            rps.push_back(jpp->idx);
+    }
+    BOOST_REQUIRE_EQUAL(rps.size(), 1);
+
+    auto result = get_stop_times(rps, navitia::DateTimeUtils::set(0, 7*3600), navitia::DateTimeUtils::inf, 3, *b.data, false);
+    BOOST_REQUIRE_EQUAL(result.size(), 3);
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::hour(result[0].first), 8*3600);
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::hour(result[1].first), 8*3600 + 600);
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::hour(result[2].first), 8*3600 + 1200);
+
+    //the window bounds the departures
+    result = get_stop_times(rps, navitia::DateTimeUtils::set(0, 7*3600), navitia::DateTimeUtils::set(0, 8*3600 + 1500), 100, *b.data, false);
+    BOOST_CHECK_EQUAL(result.size(), 3);
+}
+
+/// the departures follow the realtime overlay, without reloading the data
+BOOST_AUTO_TEST_CASE(realtime_overlay){
+    ed::builder b("20120614");
+    b.vj("A")("stop1", 8000, 8050)("stop2", 8100, 8150);
+    b.vj("A")("stop1", 8500, 8550)("stop2", 8600, 8650);
+    b.vj("A")("stop1", 9000, 9050)("stop2", 9100, 9150);
+    b.data->pt_data->index();
+    b.data->build_raptor();
+
+    std::vector<navitia::type::idx_t> rps;
+    for(auto jpp : b.data->pt_data->journey_pattern_points) {
+        if(jpp->stop_point->uri == "stop1")
+            rps.push_back(jpp->idx);
+    }
+    auto overlay = std::make_shared<navitia::type::RealtimeOverlay>();
+    navitia::type::TripUpdate delay;
+    delay.delay = 1200;
+    overlay->set(b.data->pt_data->vehicle_journeys[0], 0, delay);
+    navitia::type::TripUpdate cancellation;
+    cancellation.cancelled = true;
+    overlay->set(b.data->pt_data->vehicle_journeys[1], 0, cancellation);
+    b.data->set_realtime_overlay(overlay);
+
+    auto result = get_stop_times(rps, navitia::DateTimeUtils::set(0, 7000), navitia::DateTimeUtils::set(0, 10000), 10, *b.data, false);
+    BOOST_REQUIRE_EQUAL(result.size(), 2);
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::hour(result[0].first), 9050);
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::hour(result[1].first), 8050 + 1200);
+    BOOST_CHECK_EQUAL(result[1].second->vehicle_journey, b.data->pt_data->vehicle_journeys[0]);
+
+    //the other days are not disrupted
+    result = get_stop_times(rps, navitia::DateTimeUtils::set(1, 7000), navitia::DateTimeUtils::set(1, 10000), 10, *b.data, false);
+    BOOST_CHECK_EQUAL(result.size(), 3);
+}
+
+/// with delays, the departures are the first ones at their realtime time, even when the list is truncated
+BOOST_AUTO_TEST_CASE(realtime_overlay_truncated){
+    ed::builder b("20120614");
+    b.vj("A")("stop1", 36000, 36000)("stop2", 36600, 36600);
+    b.vj("A")("stop1", 36300, 36300)("stop2", 36900, 36900);
+    b.vj("A")("stop1", 39600, 39600)("stop2", 40200, 40200);
+    b.data->pt_data->index();
+    b.data->build_raptor();
+
+    std::vector<navitia::type::idx_t> rps;
+    for(auto jpp : b.data->pt_data->journey_pattern_points) {
+        if(jpp->stop_point->uri == "stop1")
+            rps.push_back(jpp->idx);
+    }
+    auto vj_leaving_at = [&](uint32_t departure) -> const navitia::type::VehicleJourney* {
+        for(auto vj : b.data->pt_data->vehicle_journeys) {
+            if(vj->stop_time_list.front()->departure_time == departure)
+                return vj;
+        }
+        return nullptr;
+    };
+    auto overlay = std::make_shared<navitia::type::RealtimeOverlay>();
+    navitia::type::TripUpdate late;
+    late.delay = 900;
+    overlay->set(vj_leaving_at(36000), 0, late);
+    navitia::type::TripUpdate early;
+    early.delay = -600;
+    overlay->set(vj_leaving_at(39600), 0, early);
+    b.data->set_realtime_overlay(overlay);
+
+    //the late trip runs after the next one, which is the first departure
+    auto result = get_stop_times(rps, navitia::DateTimeUtils::set(0, 35000), navitia::DateTimeUtils::inf, 1, *b.data, false);
+    BOOST_REQUIRE_EQUAL(result.size(), 1);
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::hour(result[0].first), 36300);
+
+    result = get_stop_times(rps, navitia::DateTimeUtils::set(0, 35000), navitia::DateTimeUtils::inf, 2, *b.data, false);
+    BOOST_REQUIRE_EQUAL(result.size(), 2);
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::hour(result[0].first), 36300);
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::hour(result[1].first), 36900);
+    BOOST_CHECK_EQUAL(result[1].second->vehicle_journey, vj_leaving_at(36000));
+
+    //a trip scheduled before dt still runs after it
+    result = get_stop_times(rps, navitia::DateTimeUtils::set(0, 36600), navitia::DateTimeUtils::inf, 1, *b.data, false);
+    BOOST_REQUIRE_EQUAL(result.size(), 1);
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::hour(result[0].first), 36900);
+
+    //a trip scheduled after max_dt runs before it
+    result = get_stop_times(rps, navitia::DateTimeUtils::set(0, 37000), navitia::DateTimeUtils::set(0, 39300), 10, *b.data, false);
+    BOOST_REQUIRE_EQUAL(result.size(), 1);
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::hour(result[0].first), 39000);
+    BOOST_CHECK_EQUAL(result[0].second->vehicle_journey, vj_leaving_at(39600));
+}
@@ -0,0 +1,102 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE test_ed
+#include <boost/test/unit_test.hpp>
+#include "time_tables/2stops_schedules.h"
+#include "ed/build_helper.h"
+#include "type/type.h"
+
+struct logger_initialized {
+    logger_initialized()   { init_logger(); }
+};
+BOOST_GLOBAL_FIXTURE( logger_initialized )
+
+using namespace navitia::timetables;
+
+/// only the journey patterns going from the departure to the arrival are kept
+BOOST_AUTO_TEST_CASE(same_journey_pattern) {
+    ed::builder b("20120614");
+    b.vj("A")("stop1", 8000, 8050)("stop2", 8100, 8150)("stop3", 8200, 8250);
+    b.vj("A")("stop1", 9000, 9050)("stop2", 9100, 9150)("stop3", 9200, 9250);
+    b.vj("B")("stop3", 8000, 8050)("stop1", 8100, 8150)("stop4", 8200, 8250);
+    b.data->pt_data->index();
+    b.data->build_raptor();
+
+    auto result = stops_schedule("stop_point.uri=stop1", "stop_point.uri=stop3", {},
+                                 navitia::DateTimeUtils::set(0, 7000), navitia::DateTimeUtils::set(1, 0),
+                                 *b.data, false);
+    BOOST_REQUIRE_EQUAL(result.size(), 2);
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::hour(result[0].first.first), 8050);
+    BOOST_CHECK_EQUAL(result[0].second.second->journey_pattern_point->stop_point->uri, "stop3");
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::hour(result[0].second.first), 8200);
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::hour(result[1].first.first), 9050);
+
+    //the other way, only B goes from stop3 to stop1
+    result = stops_schedule("stop_point.uri=stop3", "stop_point.uri=stop1", {},
+                            navitia::DateTimeUtils::set(0, 7000), navitia::DateTimeUtils::set(1, 0),
+                            *b.data, false);
+    BOOST_REQUIRE_EQUAL(result.size(), 1);
+    BOOST_CHECK_EQUAL(result[0].first.second->vehicle_journey->journey_pattern->route->line->uri, "B");
+}
+
+/// a trip that does not stop at the arrival anymore is not listed
+BOOST_AUTO_TEST_CASE(skipped_arrival) {
+    ed::builder b("20120614");
+    b.vj("A")("stop1", 8000, 8050)("stop2", 8100, 8150)("stop3", 8200, 8250);
+    b.vj("A")("stop1", 9000, 9050)("stop2", 9100, 9150)("stop3", 9200, 9250);
+    b.data->pt_data->index();
+    b.data->build_raptor();
+
+    auto overlay = std::make_shared<navitia::type::RealtimeOverlay>();
+    navitia::type::TripUpdate update;
+    update.skipped_orders = {2};
+    overlay->set(b.data->pt_data->vehicle_journeys[0], 0, update);
+    b.data->set_realtime_overlay(overlay);
+
+    auto result = stops_schedule("stop_point.uri=stop1", "stop_point.uri=stop3", {},
+                                 navitia::DateTimeUtils::set(0, 7000), navitia::DateTimeUtils::set(1, 0),
+                                 *b.data, false);
+    BOOST_REQUIRE_EQUAL(result.size(), 1);
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::hour(result[0].first.first), 9050);
+
+    //the trip still goes to the stops it serves
+    result = stops_schedule("stop_point.uri=stop1", "stop_point.uri=stop2", {},
+                            navitia::DateTimeUtils::set(0, 7000), navitia::DateTimeUtils::set(1, 0),
+                            *b.data, false);
+    BOOST_CHECK_EQUAL(result.size(), 2);
+
+    //the next day is not disrupted
+    result = stops_schedule("stop_point.uri=stop1", "stop_point.uri=stop3", {},
+                            navitia::DateTimeUtils::set(1, 7000), navitia::DateTimeUtils::set(2, 0),
+                            *b.data, false);
+    BOOST_CHECK_EQUAL(result.size(), 2);
+}
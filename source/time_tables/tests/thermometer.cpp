@@ -32,6 +32,7 @@ www.navitia.io
 #define BOOST_TEST_MODULE test_ed
 #include <boost/test/unit_test.hpp>
 #include "time_tables/thermometer.h"
+#include "time_tables/route_schedules.h"
 
 #include "ed/build_helper.h"
 
@@ -335,3 +336,54 @@ BOOST_AUTO_TEST_CASE(tmp) {
 //            BOOST_CHECK_LE(get_lower_bound({{1,2,1}, {1,2}}), 3);
 //            BOOST_CHECK_LE(get_lower_bound({{1,2,1}, {1,2,3}}), 4);
 //        }
+
+/// the thermometer of a set of journey patterns is computed once per data
+BOOST_AUTO_TEST_CASE(cached_thermometer) {
+    ed::builder b("20120614");
+    b.vj("A")("stop1", 8000, 8050)("stop2", 8100, 8150)("stop3", 8200, 8250);
+    b.vj("B")("stop1", 9000, 9050)("stop3", 9200, 9250);
+    b.data->pt_data->index();
+
+    const vector_idx jps = {0, 1};
+    auto thermometer = get_thermometer(jps, *b.data);
+    BOOST_REQUIRE_EQUAL(thermometer->get_thermometer().size(), 3);
+    BOOST_CHECK_EQUAL(b.data->thermometer_cache.misses(), 1);
+
+    auto cached = get_thermometer(jps, *b.data);
+    BOOST_CHECK_EQUAL(b.data->thermometer_cache.hits(), 1);
+    BOOST_CHECK_EQUAL(cached.get(), thermometer.get());
+
+    //another set of journey patterns has its own thermometer
+    auto other = get_thermometer({1}, *b.data);
+    BOOST_CHECK_EQUAL(other->get_thermometer().size(), 2);
+}
+
+/// a stop skipped by the realtime update of a trip leaves an empty cell in the schedule
+BOOST_AUTO_TEST_CASE(route_schedule_skipped_stop) {
+    ed::builder b("20120614");
+    b.vj("A")("stop1", 8000, 8050)("stop2", 8100, 8150)("stop3", 8200, 8250);
+    b.vj("A")("stop1", 9000, 9050)("stop2", 9100, 9150)("stop3", 9200, 9250);
+    b.data->pt_data->index();
+    b.data->build_raptor();
+
+    auto overlay = std::make_shared<navitia::type::RealtimeOverlay>();
+    navitia::type::TripUpdate update;
+    update.delay = 60;
+    update.skipped_orders = {1};
+    overlay->set(b.data->pt_data->vehicle_journeys[0], 0, update);
+    b.data->set_realtime_overlay(overlay);
+
+    const vector_idx jps = {0};
+    auto stop_times = get_all_stop_times(jps, navitia::DateTimeUtils::set(0, 7000),
+                                         navitia::DateTimeUtils::set(1, 0), *b.data, false);
+    BOOST_REQUIRE_EQUAL(stop_times.size(), 2);
+    BOOST_REQUIRE_EQUAL(stop_times[0].size(), 3);
+    BOOST_CHECK_EQUAL(stop_times[0][0].second->vehicle_journey, b.data->pt_data->vehicle_journeys[0]);
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::hour(stop_times[0][0].first), 8050 + 60);
+    BOOST_CHECK(stop_times[0][1].second == nullptr);
+    BOOST_CHECK_EQUAL(navitia::DateTimeUtils::hour(stop_times[0][2].first), 8250 + 60);
+    //the other trip serves every stop
+    for(const auto& dt_st : stop_times[1]) {
+        BOOST_CHECK(dt_st.second != nullptr);
+    }
+}
@@ -144,7 +144,7 @@ void Thermometer::generate_thermometer(const std::vector<vector_idx> &journey_pa
 }
 
 
-vector_idx Thermometer::get_thermometer() const {
+const vector_idx& Thermometer::get_thermometer() const {
     return thermometer;
 }
 
@@ -36,12 +36,16 @@ www.navitia.io
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/iostreams/filtering_streambuf.hpp>
+#include <boost/iostreams/stream.hpp>
+#include <future>
+#include <set>
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
 
 #include "third_party/eos_portable_archive/portable_iarchive.hpp"
 #include "third_party/eos_portable_archive/portable_oarchive.hpp"
 #include "lz4_filter/filter.h"
+#include "lz4_filter/container.h"
 #include "utils/functions.h"
 #include "utils/exception.h"
 
@@ -50,6 +54,7 @@ www.navitia.io
 #include "georef/georef.h"
 #include "fare/fare.h"
 #include "type/meta_data.h"
+#include "type/flat_file.h"
 
 namespace pt = boost::posix_time;
 
@@ -57,20 +62,52 @@ namespace navitia { namespace type {
 
 Data::Data() : meta(std::make_unique<MetaData>()),
         pt_data(std::make_unique<PT_Data>()),
-        geo_ref(std::make_unique<navitia::georef::GeoRef>()),
+        geo_ref(std::make_shared<navitia::georef::GeoRef>()),
         dataRaptor(std::make_unique<navitia::routing::dataRAPTOR>()),
-        fare(std::make_unique<navitia::fare::Fare>()){
+        fare(std::make_shared<navitia::fare::Fare>()),
+        response_cache(64 * 1024 * 1024),
+        thermometer_cache(100000),
+        realtime_overlay(std::make_shared<RealtimeOverlay>()){
     this->is_connected_to_rabbitmq = false;
     this->loaded = false;
+    this->realtime_overlay_version = 0;
 }
 
 Data::~Data(){}
 
-bool Data::load(const std::string & filename) {
+std::shared_ptr<const RealtimeOverlay> Data::get_realtime_overlay() const {
+    std::lock_guard<std::mutex> lock(realtime_mutex);
+    return realtime_overlay;
+}
+
+void Data::set_realtime_overlay(std::shared_ptr<const RealtimeOverlay> overlay) {
+    std::lock_guard<std::mutex> lock(realtime_mutex);
+    realtime_overlay = std::move(overlay);
+    ++realtime_overlay_version;
+}
+
+size_t Data::message_window(const pt::ptime& now) const {
+    std::call_once(message_boundaries_once, [&]() {
+        for(const auto& uri_message : pt_data->message_holder.messages) {
+            const pt::time_period& period = uri_message.second->publication_period;
+            if(period.is_null()) {
+                continue;
+            }
+            message_boundaries.push_back(period.begin());
+            message_boundaries.push_back(period.end());
+        }
+        std::sort(message_boundaries.begin(), message_boundaries.end());
+        message_boundaries.erase(std::unique(message_boundaries.begin(), message_boundaries.end()),
+                                 message_boundaries.end());
+    });
+    return std::upper_bound(message_boundaries.begin(), message_boundaries.end(), now) - message_boundaries.begin();
+}
+
+bool Data::load(const std::string & filename, const Data* previous) {
     log4cplus::Logger logger = log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("logger"));
     try {
-        this->load_lz4(filename);
-        this->build_raptor();
+        this->load_lz4(filename, previous);
+        this->build_raptor(filename);
         last_load_at = pt::microsec_clock::local_time();
         last_load = true;
         loaded = true;
@@ -88,7 +125,11 @@ bool Data::load(const std::string & filename) {
     return this->last_load;
 }
 
-void Data::load_lz4(const std::string & filename) {
+void Data::load_lz4(const std::string & filename, const Data* previous) {
+    if(LZ4ContainerReader::is_container(filename)) {
+        this->load_lz4_container(filename, previous);
+        return;
+    }
     std::ifstream ifs(filename.c_str(),  std::ios::in | std::ios::binary);
     boost::iostreams::filtering_streambuf<boost::iostreams::input> in;
     in.push(LZ4Decompressor(2048*500),8192*500, 8192*500);
@@ -97,9 +138,111 @@ void Data::load_lz4(const std::string & filename) {
     ia >> *this;
 }
 
+void Data::load_lz4_container(const std::string & filename, const Data* previous) {
+    log4cplus::Logger logger = log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("logger"));
+    LZ4ContainerReader reader(filename);
+    // the georef and the fare are shared with the previous generation if their sections did not change
+    auto unchanged = [&](const std::string& section) {
+        section_fingerprints[section] = reader.fingerprint(section);
+        if(!previous) {
+            return false;
+        }
+        auto it = previous->section_fingerprints.find(section);
+        return it != previous->section_fingerprints.end() && it->second == section_fingerprints[section];
+    };
+    const bool same_geo_ref = unchanged("georef");
+    const bool same_fare = unchanged("fare");
+    // the flat file is identified by the timetables it was computed from
+    section_fingerprints["meta"] = reader.fingerprint("meta");
+    section_fingerprints["pt_data"] = reader.fingerprint("pt_data");
+
+    // all the sections are independent, they are loaded in parallel
+    auto load_meta = std::async(std::launch::async, [&]() {
+        boost::iostreams::stream<LZ4ContainerReader::Source> in(reader.section("meta"));
+        eos::portable_iarchive ia(in);
+        ia >> *meta;
+    });
+    std::future<void> load_fare, load_geo_ref;
+    if(same_fare) {
+        fare = previous->fare;
+        LOG4CPLUS_INFO(logger, "fare unchanged, shared with the previous data");
+    } else {
+        load_fare = std::async(std::launch::async, [&]() {
+            boost::iostreams::stream<LZ4ContainerReader::Source> in(reader.section("fare"));
+            eos::portable_iarchive ia(in);
+            ia >> *fare;
+        });
+    }
+    if(same_geo_ref) {
+        geo_ref = previous->geo_ref;
+        LOG4CPLUS_INFO(logger, "georef unchanged, shared with the previous data");
+    } else {
+        load_geo_ref = std::async(std::launch::async, [&]() {
+            boost::iostreams::stream<LZ4ContainerReader::Source> in(reader.section("georef"));
+            eos::portable_iarchive ia(in);
+            ia >> *geo_ref;
+        });
+    }
+    {
+        boost::iostreams::stream<LZ4ContainerReader::Source> in(reader.section("pt_data"));
+        eos::portable_iarchive ia(in);
+        ia >> this->version;
+        if(this->version != data_version) {
+            unsigned int v = data_version;
+            LOG4CPLUS_WARN(logger, boost::format("Attention le fichier de données est à la version %u (version actuelle : %d)") % this->version % v);
+        }
+        ia >> *pt_data;
+    }
+    load_meta.get();
+    if(load_fare.valid()) {
+        load_fare.get();
+    }
+    if(load_geo_ref.valid()) {
+        load_geo_ref.get();
+    }
+    this->relink_admins();
+}
+
+void Data::relink_admins() {
+    std::set<navitia::georef::Admin*> copies;
+    std::vector<navitia::georef::Admin*> to_visit;
+    auto relink = [&](std::vector<navitia::georef::Admin*>& admin_list) {
+        for(navitia::georef::Admin*& admin : admin_list) {
+            if(copies.insert(admin).second) {
+                to_visit.push_back(admin);
+            }
+            if(admin->idx >= geo_ref->admins.size()) {
+                throw navitia::exception("admin " + admin->uri + " of the pt_data not found in the georef");
+            }
+            admin = geo_ref->admins[admin->idx];
+        }
+    };
+    for(StopArea* stop_area : pt_data->stop_areas) {
+        relink(stop_area->admin_list);
+    }
+    for(StopPoint* stop_point : pt_data->stop_points) {
+        relink(stop_point->admin_list);
+    }
+    // the admins of the copies are copies too
+    while(!to_visit.empty()) {
+        navitia::georef::Admin* admin = to_visit.back();
+        to_visit.pop_back();
+        for(navitia::georef::Admin* parent : admin->admin_list) {
+            if(copies.insert(parent).second) {
+                to_visit.push_back(parent);
+            }
+        }
+    }
+    for(navitia::georef::Admin* admin : copies) {
+        delete admin;
+    }
+}
+
 void Data::save(const std::string & filename){
     log4cplus::Logger logger = log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("logger"));
     this->save_lz4(filename);
+    // the flat file is identified by the data file, it has to be written after it
+    this->save_flat(filename);
 }
 
 void Data::save_lz4(const std::string & filename) {
@@ -118,12 +261,34 @@ void Data::save_lz4(const std::string & filename) {
        throw navitia::exception("Unable to write file");
     }
     try {
-        std::ofstream ofs(filename.c_str(),std::ios::out|std::ios::binary|std::ios::trunc);
-        boost::iostreams::filtering_streambuf<boost::iostreams::output> out;
-        out.push(LZ4Compressor(2048*500), 1024*500, 1024*500);
-        out.push(ofs);
-        eos::portable_oarchive oa(out);
-        oa << *this;
+        LZ4ContainerWriter writer(filename);
+        writer.begin_section("meta");
+        {
+            boost::iostreams::stream<LZ4ContainerWriter::Sink> out(writer.sink());
+            eos::portable_oarchive oa(out);
+            oa << *meta;
+        }
+        writer.begin_section("fare");
+        {
+            boost::iostreams::stream<LZ4ContainerWriter::Sink> out(writer.sink());
+            eos::portable_oarchive oa(out);
+            oa << *fare;
+        }
+        // the pt_data section has its own copy of the admins it points to, see relink_admins
+        writer.begin_section("georef");
+        {
+            boost::iostreams::stream<LZ4ContainerWriter::Sink> out(writer.sink());
+            eos::portable_oarchive oa(out);
+            oa << *geo_ref;
+        }
+        writer.begin_section("pt_data");
+        {
+            boost::iostreams::stream<LZ4ContainerWriter::Sink> out(writer.sink());
+            eos::portable_oarchive oa(out);
+            const unsigned int v = data_version;
+            oa << v << *pt_data;
+        }
+        writer.close();
     } catch(const boost::filesystem::filesystem_error &e) {
         if(e.code() == boost::system::errc::permission_denied)
             LOG4CPLUS_ERROR(logger, "Writing permission is denied for " << p);
@@ -141,6 +306,9 @@ void Data::save_lz4(const std::string & filename) {
             LOG4CPLUS_ERROR(logger, "Operation not permitted while writing " << p);
         LOG4CPLUS_ERROR(logger, e.what());
        throw navitia::exception("Unable to write file");
+    } catch(const std::runtime_error &e) {
+        LOG4CPLUS_ERROR(logger, e.what());
+        throw navitia::exception("Unable to write file");
     }
 }
 
@@ -175,6 +343,72 @@ void Data::build_raptor() {
     dataRaptor->load(*this->pt_data);
 }
 
+namespace {
+/// version of the content of the flat file, to increment when the flat sections change
+const uint64_t flat_version = 3;
+
+/** identify the data (and the loaded data) for which a flat file has been written
+  *
+  * the fingerprints of the sections are written in the data file, a copy of the files
+  * that does not keep their dates still matches
+  */
+std::vector<uint64_t> flat_key(const std::map<std::string, uint64_t>& fingerprints, const PT_Data& pt_data) {
+    return {flat_version, Data::data_version,
+            fingerprints.at("meta"), fingerprints.at("pt_data"),
+            pt_data.stop_times.size(), pt_data.vehicle_journeys.size(),
+            pt_data.journey_patterns.size(), pt_data.journey_pattern_points.size()};
+}
+}
+
+void Data::build_raptor(const std::string & filename) {
+    auto logger = log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("logger"));
+    const std::string flat_filename = filename + ".flat";
+    const std::vector<uint64_t> key = flat_key(section_fingerprints, *pt_data);
+
+    std::shared_ptr<const MappedFlatFile> flat_file;
+    try {
+        flat_file = std::make_shared<const MappedFlatFile>(flat_filename);
+        auto file_key = flat_file->get<uint64_t>("meta.key");
+        if(file_key.second != key.size() || !std::equal(key.begin(), key.end(), file_key.first)) {
+            LOG4CPLUS_WARN(logger, "the flat file " << flat_filename << " does not match the data, it is ignored");
+            flat_file.reset();
+        }
+    } catch(const navitia::exception& e) {
+        //no flat file (data written by an older ed2nav) or an invalid one: everything is computed
+        LOG4CPLUS_INFO(logger, e.what());
+        flat_file.reset();
+    }
+
+    dataRaptor->load(*this->pt_data, flat_file);
+    if(dataRaptor->arrival_times.is_mapped()) {
+        LOG4CPLUS_INFO(logger, "raptor timetables mapped from " << flat_filename);
+    }
+    if(dataRaptor->foot_path_forward.is_mapped()) {
+        LOG4CPLUS_INFO(logger, "raptor foot paths mapped from " << flat_filename);
+    }
+}
+
+void Data::save_flat(const std::string & filename) const {
+    auto logger = log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("logger"));
+    const std::string flat_filename = filename + ".flat";
+    try {
+        // the fingerprints are the ones of the data file just written
+        LZ4ContainerReader reader(filename);
+        const std::map<std::string, uint64_t> fingerprints = {
+            {"meta", reader.fingerprint("meta")}, {"pt_data", reader.fingerprint("pt_data")}};
+        navitia::routing::dataRAPTOR raptor;
+        raptor.load(*this->pt_data);
+        FlatFileWriter writer;
+        writer.add("meta.key", flat_key(fingerprints, *pt_data));
+        raptor.save_flat(writer);
+        writer.write(flat_filename);
+        LOG4CPLUS_INFO(logger, "raptor timetables and foot paths written in " << flat_filename);
+    } catch(const std::exception& e) {
+        // kraken can still load the data without it, it will just be slower to start
+        LOG4CPLUS_WARN(logger, "unable to write the flat file " << flat_filename << ": " << e.what());
+    }
+}
+
 ValidityPattern* Data::get_similar_validity_pattern(ValidityPattern* vp) const{
     auto find_vp_predicate = [&](ValidityPattern* vp1) { return ((*vp) == (*vp1));};
     auto it = std::find_if(this->pt_data->validity_patterns.begin(),
@@ -388,19 +622,21 @@ Data::get_data<StopPointConnection>() const {
 }
 
 
-std::vector<idx_t> Data::get_all_index(Type_e type) const {
-    size_t num_elements = 0;
+size_t Data::nb_elements(Type_e type) const {
     switch(type){
     #define GET_NUM_ELEMENTS(type_name, collection_name)\
     case Type_e::type_name:\
-        num_elements = this->pt_data->collection_name.size();break;
+        return this->pt_data->collection_name.size();
     ITERATE_NAVITIA_PT_TYPES(GET_NUM_ELEMENTS)
-    case Type_e::POI: num_elements = this->geo_ref->pois.size(); break;
-    case Type_e::POIType: num_elements = this->geo_ref->poitypes.size(); break;
-    case Type_e::Connection:
-        num_elements = this->pt_data->stop_point_connections.size(); break;
-    default:  break;
+    case Type_e::POI: return this->geo_ref->pois.size();
+    case Type_e::POIType: return this->geo_ref->poitypes.size();
+    case Type_e::Connection: return this->pt_data->stop_point_connections.size();
+    default: return 0;
     }
+}
+
+std::vector<idx_t> Data::get_all_index(Type_e type) const {
+    const size_t num_elements = nb_elements(type);
     std::vector<idx_t> indexes(num_elements);
     for(size_t i=0; i < num_elements; i++)
         indexes[i] = i;
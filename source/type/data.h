@@ -33,9 +33,14 @@ www.navitia.io
 #include "utils/configuration.h"
 #include <boost/utility.hpp>
 #include <boost/serialization/version.hpp>
+#include <boost/serialization/split_member.hpp>
 #include <boost/format.hpp>
 #include <atomic>
+#include <map>
+#include <mutex>
 #include "type/type.h"
+#include "type/lru_cache.h"
+#include "type/realtime_overlay.h"
 #include "utils/serialization_unique_ptr.h"
 
 //forward declare
@@ -52,6 +57,10 @@ namespace navitia{
     namespace type{
         class MetaData;
     }
+    namespace timetables{
+        struct Thermometer;
+        class DayIndex;
+    }
 }
 
 namespace navitia { namespace type {
@@ -77,13 +86,68 @@ public:
     /// Référentiel de transport en commun
     std::unique_ptr<PT_Data> pt_data;
 
-    std::unique_ptr<navitia::georef::GeoRef> geo_ref;
+    /// Partagé avec la génération précédente s'il n'a pas changé lors d'un rechargement
+    std::shared_ptr<navitia::georef::GeoRef> geo_ref;
 
     /// Données précalculées pour le raptor
     std::unique_ptr<navitia::routing::dataRAPTOR> dataRaptor;
 
-    /// Fare data
-    std::unique_ptr<navitia::fare::Fare> fare;
+    /// Fare data, shared with the previous generation if it did not change
+    std::shared_ptr<navitia::fare::Fare> fare;
+
+    /// Empreintes des sections du conteneur chargé, pour savoir au rechargement ce qui a changé
+    std::map<std::string, uint64_t> section_fingerprints;
+
+    /** Réponses sérialisées des apis idempotentes, indexées par la requête canonique
+      *
+      * Elles ne dépendent que de la requête, des données et des messages publiés : le cache vit
+      * avec la génération et la clé porte la fenêtre de publication des messages (message_window).
+      * Le poids d'une entrée est sa taille en octets, 64Mo par défaut (clé response_cache_size de kraken)
+      */
+    navitia::LruCache<std::string, std::string> response_cache;
+
+    /** Numéro de la fenêtre de publication des messages qui contient now
+      *
+      * Les messages publiés ne changent qu'au début ou à la fin d'une période de publication :
+      * entre deux de ces instants les réponses sont les mêmes
+      */
+    size_t message_window(const boost::posix_time::ptime& now) const;
+
+    /** Thermomètres des grilles horaires, indexés par la liste des journey patterns de la route
+      *
+      * Ils sont calculés à la première demande et réutilisés jusqu'au rechargement
+      */
+    navitia::LruCache<std::vector<idx_t>, navitia::timetables::Thermometer> thermometer_cache;
+
+    /** Index des départs par jour de service (date, perturbations actives), construits à la demande
+      *
+      * Seuls les day_index_days prochains jours sont indexés, 0 désactive les index
+      */
+    mutable navitia::LruCache<std::pair<uint32_t, bool>, navitia::timetables::DayIndex> day_index_cache;
+    /// un seul index est créé par jour
+    mutable std::mutex day_index_mutex;
+    uint32_t day_index_days = 0;
+    /// premier jour de l'horizon indexé, aujourd'hui (day_clock::local_day) s'il n'est pas renseigné
+    boost::gregorian::date day_index_today;
+
+private:
+    /// débuts et fins des périodes de publication des messages, triés, calculés à la première demande
+    mutable std::vector<boost::posix_time::ptime> message_boundaries;
+    mutable std::once_flag message_boundaries_once;
+
+public:
+
+    /// Données temps réel appliquées aux horaires, jamais nul
+    std::shared_ptr<const RealtimeOverlay> get_realtime_overlay() const;
+
+    /** Remplace les données temps réel sans recharger les données
+      *
+      * Les réponses en cache ne sont plus servies : leur clé porte la version précédente
+      */
+    void set_realtime_overlay(std::shared_ptr<const RealtimeOverlay> overlay);
+
+    /// numéro de la version des données temps réel, incrémenté à chaque remplacement
+    uint64_t realtime_version() const { return realtime_overlay_version.load(); }
 
     /** Retourne la structure de données associée au type */
     /// TODO : attention aux perfs à faire la copie
@@ -96,6 +160,9 @@ public:
       */
     std::vector<idx_t> get_all_index(Type_e type) const;
 
+    /// Nombre d'éléments d'un type donné, sans construire la liste de leurs indices
+    size_t nb_elements(Type_e type) const;
+
 
     /** Étant donné une liste d'indexes pointant vers source,
       * retourne une liste d'indexes pointant vers target
@@ -125,19 +192,35 @@ public:
       *
       * Elle est appelée par boost et pas directement
       */
-    template<class Archive> void serialize(Archive & ar, const unsigned int version) {
+    template<class Archive> void save(Archive & ar, const unsigned int) const {
+        // geo_ref and fare are shared_ptr since they can be shared between generations,
+        // they are written as the raw pointers of the unique_ptr they used to be
+        const navitia::georef::GeoRef* g = geo_ref.get();
+        const navitia::fare::Fare* f = fare.get();
+        ar & pt_data & g & meta & f;
+    }
+
+    template<class Archive> void load(Archive & ar, const unsigned int version) {
         this->version = version;
         if(this->version != data_version){
             log4cplus::Logger logger = log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("logger"));
             unsigned int v = data_version;//sinon ca link pas...
             LOG4CPLUS_WARN(logger, boost::format("Attention le fichier de données est à la version %u (version actuelle : %d)") % version % v);
         }
-
-        ar & pt_data & geo_ref & meta & fare;
+        navitia::georef::GeoRef* g = nullptr;
+        navitia::fare::Fare* f = nullptr;
+        ar & pt_data & g & meta & f;
+        geo_ref.reset(g);
+        fare.reset(f);
     }
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
 
-    /** Charge les données et effectue les initialisations nécessaires */
-    bool load(const std::string & filename);
+    /** Charge les données et effectue les initialisations nécessaires
+      *
+      * Si previous est donné, les sections du fichier qui n'ont pas changé depuis son chargement
+      * (georef, fare) ne sont pas relues : elles sont partagées avec previous
+      */
+    bool load(const std::string & filename, const Data* previous = nullptr);
 
     /** Sauvegarde les données */
     void save(const std::string & filename);
@@ -155,6 +238,12 @@ public:
     void build_administrative_regions();
     /** Construit les données raptor */
     void build_raptor();
+    /** Construit les données raptor des données chargées depuis filename
+      *
+      * Les horaires et les correspondances sont mappés depuis le fichier à plat <filename>.flat
+      * s'il correspond aux données, sinon ils sont calculés : rien n'est écrit au chargement
+      */
+    void build_raptor(const std::string & filename);
     /** Construction des validity pattern des StopTimes **/
     void build_midnight_interchange();
 
@@ -166,15 +255,31 @@ public:
     /** Retourne le type de l'id donné */
     Type_e get_type_of_id(const std::string & id) const;
 private:
+    mutable std::mutex realtime_mutex;
+    std::shared_ptr<const RealtimeOverlay> realtime_overlay;
+    std::atomic<uint64_t> realtime_overlay_version;
+
     /** Charge les données binaires compressées en LZ4
       *
       * La compression LZ4 est extrèmement rapide mais moyennement performante
       * Le but est que la lecture du fichier compression soit aussi rapide que sans compression
       */
-    void load_lz4(const std::string & filename);
+    void load_lz4(const std::string & filename, const Data* previous = nullptr);
+
+    /** Charge les données d'un conteneur LZ4 : chaque section est décompressée sur plusieurs threads,
+      * et les sections indépendantes sont chargées en parallèle
+      * Les sections georef et fare inchangées depuis le chargement de previous sont partagées avec lui */
+    void load_lz4_container(const std::string & filename, const Data* previous);
 
-    /** Sauvegarde les données en binaire compressé avec LZ4*/
+    /** Sauvegarde les données dans un conteneur LZ4 (sections meta, fare, georef et pt_data) */
     void save_lz4(const std::string & filename);
+
+    /** Écrit le fichier à plat <filename>.flat des données raptor, à appeler après l'écriture de filename */
+    void save_flat(const std::string & filename) const;
+
+    /** La section pt_data contient sa propre copie des admins des stop areas et stop points :
+      * les pointeurs sont remplacés par ceux des admins du georef et les copies sont détruites */
+    void relink_admins();
     /** Recherche d'une ValidityPattern lors de clacul du passe-minuit**/
     ValidityPattern* get_or_create_validity_pattern(ValidityPattern* ref_validity_pattern, const uint32_t time);
     /** Get similar validitypattern **/
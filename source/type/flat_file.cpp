@@ -0,0 +1,157 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#include "flat_file.h"
+#include "utils/exception.h"
+
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace navitia { namespace type {
+
+namespace {
+
+const char magic[8] = {'N', 'A', 'V', 'F', 'L', 'A', 'T', '1'};
+const size_t alignment = 64;
+
+struct Header {
+    char magic[8];
+    uint64_t nb_sections;
+};
+
+struct SectionEntry {
+    char name[48];
+    uint64_t offset;
+    uint64_t size;
+};
+
+size_t align(size_t offset) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+}
+
+void FlatFileWriter::write(const std::string& filename) const {
+    Header header;
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.nb_sections = sections.size();
+
+    std::vector<SectionEntry> entries;
+    size_t offset = align(sizeof(Header) + sections.size() * sizeof(SectionEntry));
+    for(const auto& section : sections) {
+        if(section.first.size() >= sizeof(SectionEntry::name)) {
+            throw navitia::exception("flat section name too long: " + section.first);
+        }
+        SectionEntry entry;
+        std::memset(entry.name, 0, sizeof(entry.name));
+        std::memcpy(entry.name, section.first.c_str(), section.first.size());
+        entry.offset = offset;
+        entry.size = section.second.size();
+        entries.push_back(entry);
+        offset = align(offset + section.second.size());
+    }
+
+    const std::string tmp_filename = filename + ".tmp";
+    {
+        std::ofstream ofs(tmp_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        ofs.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(SectionEntry));
+        auto entry = entries.begin();
+        for(const auto& section : sections) {
+            const std::string padding(entry->offset - size_t(ofs.tellp()), '\0');
+            ofs.write(padding.data(), padding.size());
+            ofs.write(section.second.data(), section.second.size());
+            ++entry;
+        }
+        if(!ofs) {
+            std::remove(tmp_filename.c_str());
+            throw navitia::exception("unable to write the flat file " + filename);
+        }
+    }
+    if(std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+        std::remove(tmp_filename.c_str());
+        throw navitia::exception("unable to write the flat file " + filename);
+    }
+}
+
+MappedFlatFile::MappedFlatFile(const std::string& filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0) {
+        throw navitia::exception("unable to open the flat file " + filename);
+    }
+    struct stat st;
+    if(::fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(Header)) {
+        ::close(fd);
+        throw navitia::exception("invalid flat file " + filename);
+    }
+    size = st.st_size;
+    void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(mapping == MAP_FAILED) {
+        throw navitia::exception("unable to map the flat file " + filename);
+    }
+    data = static_cast<const char*>(mapping);
+
+    const Header* header = reinterpret_cast<const Header*>(data);
+    if(std::memcmp(header->magic, magic, sizeof(magic)) != 0
+            || header->nb_sections > (size - sizeof(Header)) / sizeof(SectionEntry)) {
+        ::munmap(const_cast<char*>(data), size);
+        throw navitia::exception("invalid flat file " + filename);
+    }
+    const SectionEntry* entries = reinterpret_cast<const SectionEntry*>(data + sizeof(Header));
+    for(size_t i = 0; i < header->nb_sections; ++i) {
+        const SectionEntry& entry = entries[i];
+        if(entry.offset > size || entry.size > size - entry.offset || entry.offset % alignment != 0) {
+            ::munmap(const_cast<char*>(data), size);
+            throw navitia::exception("invalid flat file " + filename);
+        }
+        const std::string name(entry.name, strnlen(entry.name, sizeof(entry.name)));
+        sections[name] = std::make_pair(data + entry.offset, size_t(entry.size));
+    }
+}
+
+MappedFlatFile::~MappedFlatFile() {
+    ::munmap(const_cast<char*>(data), size);
+}
+
+std::pair<const char*, size_t> MappedFlatFile::get_section(const std::string& name, size_t value_size) const {
+    auto it = sections.find(name);
+    if(it == sections.end() || it->second.second % value_size != 0) {
+        throw navitia::exception("invalid flat section " + name);
+    }
+    return it->second;
+}
+
+}}
@@ -0,0 +1,137 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <map>
+#include <type_traits>
+#include <cstdint>
+#include <tuple>
+
+namespace navitia { namespace type {
+
+/** Fichier de tableaux « à plat », utilisable directement après un mmap
+  *
+  * Le fichier contient un en-tête, une table des sections (nom, position, taille),
+  * puis le contenu de chaque section, aligné sur 64 octets.
+  * Une section n'est qu'un tableau de valeurs sans pointeurs : il n'y a rien à désérialiser,
+  * et les pages sont partagées entre tous les processus qui mappent le même fichier.
+  *
+  * Les valeurs sont écrites dans l'ordre des octets de la machine,
+  * le fichier n'est donc qu'un cache local et pas un format d'échange.
+  */
+class FlatFileWriter {
+public:
+    template<typename T>
+    void add(const std::string& name, const std::vector<T>& values) {
+        static_assert(std::is_pod<T>::value, "a flat section can only contain trivial values");
+        const char* begin = reinterpret_cast<const char*>(values.data());
+        sections[name].assign(begin, begin + values.size() * sizeof(T));
+    }
+
+    /// Écrit le fichier dans un fichier temporaire puis le renomme, un lecteur ne voit jamais de fichier partiel
+    void write(const std::string& filename) const;
+
+private:
+    std::map<std::string, std::string> sections;
+};
+
+/// Fichier à plat mappé en lecture seule
+class MappedFlatFile {
+public:
+    /// Mappe le fichier, lève une navitia::exception si il n'est pas lisible ou pas valide
+    explicit MappedFlatFile(const std::string& filename);
+    ~MappedFlatFile();
+    MappedFlatFile(const MappedFlatFile&) = delete;
+    MappedFlatFile& operator=(const MappedFlatFile&) = delete;
+
+    bool has(const std::string& name) const { return sections.find(name) != sections.end(); }
+
+    /// Retourne le début et le nombre d'éléments d'une section, lève une navitia::exception si elle n'existe pas
+    template<typename T>
+    std::pair<const T*, size_t> get(const std::string& name) const {
+        auto section = get_section(name, sizeof(T));
+        return {reinterpret_cast<const T*>(section.first), section.second / sizeof(T)};
+    }
+
+private:
+    std::pair<const char*, size_t> get_section(const std::string& name, size_t value_size) const;
+
+    const char* data = nullptr;
+    size_t size = 0;
+    std::map<std::string, std::pair<const char*, size_t>> sections;
+};
+
+/** Tableau en lecture seule, soit possédé, soit pointant dans un fichier mappé
+  *
+  * Le fichier reste mappé tant qu'un tableau pointe dedans
+  */
+template<typename T>
+class FlatVector {
+public:
+    typedef const T* const_iterator;
+
+    FlatVector() {}
+    FlatVector(const FlatVector&) = delete;
+    FlatVector& operator=(const FlatVector&) = delete;
+
+    void assign(std::vector<T>&& values) {
+        owned = std::move(values);
+        file.reset();
+        begin_ = owned.data();
+        size_ = owned.size();
+    }
+
+    void map(const std::shared_ptr<const MappedFlatFile>& mapped_file, const std::string& name) {
+        std::tie(begin_, size_) = mapped_file->get<T>(name);
+        owned.clear();
+        owned.shrink_to_fit();
+        file = mapped_file;
+    }
+
+    void clear() { assign(std::vector<T>()); }
+
+    bool is_mapped() const { return file != nullptr; }
+    const T* begin() const { return begin_; }
+    const T* end() const { return begin_ + size_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const T& operator[](size_t i) const { return begin_[i]; }
+
+private:
+    std::vector<T> owned;
+    std::shared_ptr<const MappedFlatFile> file;
+    const T* begin_ = nullptr;
+    size_t size_ = 0;
+};
+
+}}
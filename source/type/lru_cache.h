@@ -0,0 +1,149 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace navitia {
+
+/** Bounded cache shared between threads, evicting the least recently used entries
+  *
+  * Each entry has a weight (by default 1) and the sum of the weights is kept under max_weight.
+  * The values are stored in shared_ptr so a reader can keep using a value
+  * even if it has been evicted in the mean time by another thread.
+  *
+  * The cache is meant to be owned by a data generation (Data, GeoRef, ...),
+  * so it is invalidated for free when a new data set is loaded.
+  */
+template<typename Key, typename Value>
+class LruCache {
+public:
+    typedef std::shared_ptr<const Value> value_ptr;
+
+    LruCache(size_t max_weight = 1000) : max_weight(max_weight) {}
+
+    LruCache(const LruCache&) = delete;
+    LruCache& operator=(const LruCache&) = delete;
+
+    /// return the cached value, or an empty pointer if the key is not in the cache
+    value_ptr get(const Key& key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(key);
+        if (it == index.end()) {
+            ++nb_misses;
+            return value_ptr();
+        }
+        ++nb_hits;
+        //the entry is now the most recently used
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->value;
+    }
+
+    /// add (or replace) a value, and evict the oldest entries if the cache is full
+    void insert(const Key& key, value_ptr value, size_t weight = 1) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (weight > max_weight) {
+            return; //no use to evict everything for an entry too big to fit
+        }
+        auto it = index.find(key);
+        if (it != index.end()) {
+            current_weight -= it->second->weight;
+            entries.erase(it->second);
+            index.erase(it);
+        }
+        entries.push_front({key, value, weight});
+        index[key] = entries.begin();
+        current_weight += weight;
+        evict();
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+        index.clear();
+        current_weight = 0;
+    }
+
+    void set_max_weight(size_t weight) {
+        std::lock_guard<std::mutex> lock(mutex);
+        max_weight = weight;
+        evict();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+
+    size_t weight() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return current_weight;
+    }
+
+    size_t hits() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return nb_hits;
+    }
+
+    size_t misses() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return nb_misses;
+    }
+
+private:
+    struct Entry {
+        Key key;
+        value_ptr value;
+        size_t weight;
+    };
+
+    mutable std::mutex mutex;
+    size_t max_weight;
+    size_t current_weight = 0;
+    size_t nb_hits = 0;
+    size_t nb_misses = 0;
+    /// most recently used first
+    std::list<Entry> entries;
+    std::map<Key, typename std::list<Entry>::iterator> index;
+
+    /// remove the least recently used entries until the cache fits (the lock must be held)
+    void evict() {
+        while (current_weight > max_weight && ! entries.empty()) {
+            current_weight -= entries.back().weight;
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
+    }
+};
+
+}
@@ -0,0 +1,93 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace navitia {
+
+/// nombre de threads des traitements parallèles, au moins 1
+inline size_t hardware_nb_threads() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/** Appelle f(i, local) pour tous les i de [0, size[ sur nb_threads threads
+  *
+  * Les éléments sont distribués par blocs aux threads. Chaque thread a son propre Local,
+  * sur sa pile pour ne pas partager de ligne de cache avec les autres : f ne doit écrire
+  * que dans local ou dans la case de son élément.
+  * Retourne les Local des threads, à fusionner par l'appelant.
+  * La première exception levée par f est relancée une fois tous les threads terminés.
+  */
+template<typename Local, typename F>
+std::vector<Local> parallel_for_locals(size_t size, F f, size_t nb_threads = hardware_nb_threads()) {
+    const size_t block_size = 64;
+    std::atomic<size_t> next_block(0);
+    std::vector<Local> locals(nb_threads);
+    std::vector<std::exception_ptr> errors(nb_threads);
+    std::vector<std::thread> threads;
+    for(size_t thread = 0; thread < nb_threads; ++thread) {
+        threads.emplace_back([&, thread]() {
+            Local local{};
+            try {
+                for(size_t begin = next_block.fetch_add(block_size); begin < size;
+                    begin = next_block.fetch_add(block_size)) {
+                    for(size_t i = begin; i < std::min(size, begin + block_size); ++i) {
+                        f(i, local);
+                    }
+                }
+            } catch(...) {
+                errors[thread] = std::current_exception();
+            }
+            locals[thread] = std::move(local);
+        });
+    }
+    for(auto& thread : threads) {
+        thread.join();
+    }
+    for(const auto& error : errors) {
+        if(error) {
+            std::rethrow_exception(error);
+        }
+    }
+    return locals;
+}
+
+/// parallel_for_locals sans état par thread : appelle f(i)
+template<typename F>
+void parallel_for(size_t size, F f, size_t nb_threads = hardware_nb_threads()) {
+    parallel_for_locals<char>(size, [&](size_t i, char&) { f(i); }, nb_threads);
+}
+
+}
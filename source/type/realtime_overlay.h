@@ -0,0 +1,156 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+#include "type/type.h"
+#include <cstdint>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace navitia { namespace type {
+
+/// Écart temps réel d'une circulation de course
+struct TripUpdate {
+    bool cancelled = false;
+    /// retard en secondes, appliqué à tous les arrêts de la course (négatif pour une avance)
+    int32_t delay = 0;
+    /// rangs (order des journey pattern points) des arrêts non desservis, triés
+    std::vector<int> skipped_orders;
+
+    /// la circulation ne prend pas de voyageurs à l'arrêt de rang order
+    bool skips(int order) const {
+        return cancelled || std::binary_search(skipped_orders.begin(), skipped_orders.end(), order);
+    }
+
+    bool operator==(const TripUpdate& other) const {
+        return cancelled == other.cancelled && delay == other.delay
+            && skipped_orders == other.skipped_orders;
+    }
+};
+
+/** Données temps réel appliquées par dessus les horaires théoriques
+  *
+  * Les écarts sont indexés par course et par jour de circulation (jours depuis le début
+  * de la production), les horaires théoriques ne sont pas modifiés.
+  * Une fois publiée l'overlay n'est plus modifiée : une mise à jour en construit une copie.
+  */
+class RealtimeOverlay {
+public:
+    void set(const VehicleJourney* vj, uint32_t date, const TripUpdate& update) {
+        auto inserted = updates.insert({key(vj->idx, date), update});
+        auto& jp_delays = delays[vj->journey_pattern->idx];
+        if(!inserted.second) {
+            remove_delay(jp_delays, inserted.first->second.delay);
+            inserted.first->second = update;
+        }
+        ++jp_delays[update.delay];
+    }
+
+    void erase(const VehicleJourney* vj, uint32_t date) {
+        auto it = updates.find(key(vj->idx, date));
+        if(it != updates.end()) {
+            auto jp_delays = delays.find(vj->journey_pattern->idx);
+            remove_delay(jp_delays->second, it->second.delay);
+            if(jp_delays->second.empty()) {
+                delays.erase(jp_delays);
+            }
+            updates.erase(it);
+        }
+    }
+
+    /// écart de la circulation, nullptr si elle est à l'heure
+    const TripUpdate* get(idx_t vj_idx, uint32_t date) const {
+        auto it = updates.find(key(vj_idx, date));
+        return it == updates.end() ? nullptr : &it->second;
+    }
+
+    bool empty() const { return updates.empty(); }
+    size_t size() const { return updates.size(); }
+
+    /// plus grand retard et plus grande avance (en secondes, positifs ou nuls) des circulations du journey pattern
+    int32_t max_delay(idx_t jp_idx) const {
+        auto it = delays.find(jp_idx);
+        return it == delays.end() ? 0 : std::max(0, it->second.rbegin()->first);
+    }
+    int32_t max_advance(idx_t jp_idx) const {
+        auto it = delays.find(jp_idx);
+        return it == delays.end() ? 0 : std::max(0, -it->second.begin()->first);
+    }
+
+private:
+    std::unordered_map<uint64_t, TripUpdate> updates;
+    /// nombre de circulations par retard de chaque journey pattern, pour connaître les bornes
+    /// sans parcourir les écarts ; un journey pattern sans écart n'a pas d'entrée
+    std::unordered_map<idx_t, std::map<int32_t, size_t>> delays;
+
+    static void remove_delay(std::map<int32_t, size_t>& jp_delays, int32_t delay) {
+        auto it = jp_delays.find(delay);
+        if(--it->second == 0) {
+            jp_delays.erase(it);
+        }
+    }
+
+    static uint64_t key(idx_t vj_idx, uint32_t date) {
+        return (uint64_t(vj_idx) << 32) | date;
+    }
+};
+
+/// jour de circulation de la course dont le stop time part à dt (l'arrêt peut être après minuit)
+inline uint32_t circulation_date(DateTime dt, const StopTime* st) {
+    return DateTimeUtils::date(dt) - st->departure_time / DateTimeUtils::SECONDS_PER_DAY;
+}
+
+/** Écart de la circulation qui passe le jour date au stop time st, nullptr si elle est à l'heure
+  *
+  * departure indique si date est le jour du départ ou de l'arrivée au stop time
+  */
+inline const TripUpdate* trip_update(const RealtimeOverlay* overlay, const StopTime* st, uint32_t date, bool departure) {
+    if(overlay == nullptr || overlay->empty()) {
+        return nullptr;
+    }
+    const uint32_t days = (departure ? st->departure_time : st->arrival_time) / DateTimeUtils::SECONDS_PER_DAY;
+    if(date < days) {
+        return nullptr;
+    }
+    return overlay->get(st->vehicle_journey->idx, date - days);
+}
+
+/// horaire décalé du retard, une avance ne passe pas avant le début de la production
+inline DateTime apply_delay(DateTime dt, int32_t delay) {
+    if(delay < 0 && DateTime(-delay) > dt) {
+        return 0;
+    }
+    return dt + delay;
+}
+
+}}
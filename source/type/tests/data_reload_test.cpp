@@ -0,0 +1,122 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE data_reload_test
+#include <boost/test/unit_test.hpp>
+#include "type/data.h"
+#include "type/pt_data.h"
+#include "ed/build_helper.h"
+#include "georef/georef.h"
+#include "fare/fare.h"
+#include "routing/dataraptor.h"
+#include <boost/filesystem.hpp>
+
+struct logger_initialized {
+    logger_initialized()   { init_logger(); }
+};
+BOOST_GLOBAL_FIXTURE( logger_initialized )
+
+static const navitia::type::StopPoint* find_stop_point(const navitia::type::Data& data, const std::string& uri) {
+    for(const navitia::type::StopPoint* stop_point : data.pt_data->stop_points) {
+        if(stop_point->uri == uri) {
+            return stop_point;
+        }
+    }
+    return nullptr;
+}
+
+/*
+ * Au rechargement, les sections georef et fare inchangées sont partagées avec les données précédentes,
+ * et les admins des stop points pointent vers ceux du georef chargé ou partagé
+ */
+BOOST_AUTO_TEST_CASE(reload_shares_unchanged_sections) {
+    ed::builder b("20120614");
+    b.vj("A")("stop1", 8000, 8050)("stop2", 8100, 8150);
+    auto admin = new navitia::georef::Admin(8);
+    admin->idx = 0;
+    admin->uri = "admin:1";
+    admin->name = "first";
+    b.data->geo_ref->admins.push_back(admin);
+    b.sps["stop1"]->admin_list.push_back(admin);
+    b.data->pt_data->index();
+
+    const std::string filename = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+    b.data->save(filename);
+
+    navitia::type::Data first;
+    BOOST_REQUIRE(first.load(filename));
+    // the flat file has been written with the data, the raptor data is mapped from it
+    BOOST_CHECK(first.dataRaptor->arrival_times.is_mapped());
+    BOOST_CHECK(first.dataRaptor->foot_path_forward.is_mapped());
+    navitia::type::Data second;
+    BOOST_REQUIRE(second.load(filename, &first));
+    BOOST_CHECK_EQUAL(second.geo_ref, first.geo_ref);
+    BOOST_CHECK_EQUAL(second.fare, first.fare);
+    BOOST_CHECK(second.pt_data.get() != first.pt_data.get());
+    auto stop_point = find_stop_point(second, "stop1");
+    BOOST_REQUIRE(stop_point);
+    BOOST_REQUIRE_EQUAL(stop_point->admin_list.size(), 1);
+    BOOST_CHECK_EQUAL(stop_point->admin_list[0], second.geo_ref->admins[0]);
+
+    //the georef changed, it is loaded again
+    admin->name = "second";
+    b.data->save(filename);
+    navitia::type::Data third;
+    BOOST_REQUIRE(third.load(filename, &second));
+    BOOST_CHECK(third.geo_ref != second.geo_ref);
+    BOOST_CHECK_EQUAL(third.fare, second.fare);
+    BOOST_CHECK_EQUAL(second.geo_ref->admins[0]->name, "first");
+    BOOST_CHECK_EQUAL(third.geo_ref->admins[0]->name, "second");
+    stop_point = find_stop_point(third, "stop1");
+    BOOST_REQUIRE(stop_point);
+    BOOST_REQUIRE_EQUAL(stop_point->admin_list.size(), 1);
+    BOOST_CHECK_EQUAL(stop_point->admin_list[0], third.geo_ref->admins[0]);
+
+    //a copy of the files that does not keep their dates still uses the flat file
+    const std::string copy = filename + ".copy";
+    boost::filesystem::copy_file(filename, copy);
+    boost::filesystem::copy_file(filename + ".flat", copy + ".flat");
+    boost::filesystem::last_write_time(copy, boost::filesystem::last_write_time(filename) - 3600);
+    navitia::type::Data copied;
+    BOOST_REQUIRE(copied.load(copy));
+    BOOST_CHECK(copied.dataRaptor->arrival_times.is_mapped());
+    boost::filesystem::remove(copy);
+    boost::filesystem::remove(copy + ".flat");
+
+    //without the flat file, the raptor data is computed and nothing is written next to the data
+    boost::filesystem::remove(filename + ".flat");
+    navitia::type::Data fourth;
+    BOOST_REQUIRE(fourth.load(filename, &third));
+    BOOST_CHECK(!fourth.dataRaptor->arrival_times.is_mapped());
+    BOOST_CHECK(!boost::filesystem::exists(filename + ".flat"));
+
+    boost::filesystem::remove(filename);
+}
@@ -35,6 +35,8 @@ www.navitia.io
 #include "type/type.h"
 #include "type/message.h"
 #include "type/data.h"
+#include "type/pt_data.h"
+#include <boost/make_shared.hpp>
 
 namespace pt = boost::posix_time;
 namespace bg = boost::gregorian;
@@ -145,6 +147,24 @@ BOOST_AUTO_TEST_CASE(message_publishable){
 
 }
 
+/// the cached responses are keyed on the window of published messages
+BOOST_AUTO_TEST_CASE(message_window){
+    Data data;
+    auto message = boost::make_shared<Message>();
+    message->uri = "message:1";
+    message->publication_period = pt::time_period(pt::time_from_string("2013-02-22 12:32:00"),
+            pt::time_from_string("2013-02-23 12:32:00"));
+    data.pt_data->message_holder.messages[message->uri] = message;
+
+    const auto before = data.message_window(pt::time_from_string("2013-02-22 12:00:00"));
+    const auto published = data.message_window(pt::time_from_string("2013-02-22 12:32:00"));
+    const auto after = data.message_window(pt::time_from_string("2013-02-23 12:32:00"));
+    BOOST_CHECK_NE(before, published);
+    BOOST_CHECK_NE(published, after);
+    BOOST_CHECK_EQUAL(published, data.message_window(pt::time_from_string("2013-02-23 12:31:59")));
+    BOOST_CHECK_EQUAL(before, data.message_window(pt::time_from_string("2013-01-01 00:00:00")));
+}
+
 BOOST_AUTO_TEST_CASE(message_is_applicable_simple){
     navitia::type::Message message;
 